@@ -1,6 +1,8 @@
 #ifndef API_H
 #define API_H
 
+#include <stdint.h>
+
 typedef struct {
   int width;
   int height;
@@ -8,16 +10,44 @@ typedef struct {
   int victory;
   int game_over;
   int accumulated_points;
-  char* data;
+  int plays; // plays of this session the server had handled when it sent the frame
+  const char* data; // borrowed, see receive_board_update
 } Board;
 
 int pacman_connect(char const *req_pipe_path, char const *notif_pipe_path, char const *server_pipe_path);
 
+/// Connection options; all zero gives what pacman_connect does.
+typedef struct {
+  uint64_t seed;     // seed for the session's random moves, 0 lets the server pick
+  int shared_frames; // ask for frames through shared memory, the pipe only carrying doorbells
+} connect_options_t;
+
+int pacman_connect_with(char const *req_pipe_path, char const *notif_pipe_path, char const *server_pipe_path,
+                        const connect_options_t *options);
+
+/// @return 1 if the server granted shared memory frames to this session, 0 otherwise.
+int pacman_shared_frames(void);
+
+/// Like pacman_connect, but asks the server to seed the session's random
+/// moves with seed, so the game can be replayed. 0 lets the server pick.
+int pacman_connect_seeded(char const *req_pipe_path, char const *notif_pipe_path, char const *server_pipe_path,
+                          uint64_t seed);
+
+/// Watches session session_id read-only: its boards arrive through
+/// receive_board_update like a player's, pacman_play does nothing and
+/// pacman_disconnect just leaves.
+/// @return 0 on success, 1 if the server has no such session or failed.
+int pacman_spectate(char const *notif_pipe_path, char const *server_pipe_path, int session_id);
+
 void pacman_play(char command);
 
 /// @return 0 if the disconnection was successful, 1 otherwise.
 int pacman_disconnect();
 
+/// Waits for the next board from the server. data points into a frame
+/// buffer the API owns: it must not be freed and stays valid until the
+/// following receive_board_update returns or the session disconnects.
+/// @return the board, with data NULL if the session ended or failed.
 Board receive_board_update(void);
 
 #endif
\ No newline at end of file
@@ -2,11 +2,24 @@
 #define BOARD_H
 
 #define MAX_MOVES 20
-#define MAX_LEVELS 20
 #define MAX_FILENAME 256
 #define MAX_GHOSTS 25
 
-#include <pthread.h>
+#include <stdint.h>
+
+#define BITSET_WORDS(bits) (((bits) + 63) / 64)
+
+static inline int bit_test(const uint64_t* set, int i) {
+    return (set[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void bit_set(uint64_t* set, int i) {
+    set[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+static inline void bit_clear(uint64_t* set, int i) {
+    set[i >> 6] &= ~((uint64_t)1 << (i & 63));
+}
 
 typedef enum {
     REACHED_PORTAL = 1,
@@ -30,6 +43,7 @@ typedef struct {
     int current_move;
     int n_moves;
     int waiting;
+    int idle; // ticks since it last acted, see tick_board
 } pacman_t;
 
 typedef struct {
@@ -40,18 +54,21 @@ typedef struct {
     int current_move;
     int waiting;
     int charged;
+    int idle; // ticks since it last acted, see tick_board
 } ghost_t;
 
-typedef struct {
-    char content; // stuff like 'P' for pacman 'M' for monster and 'W' for wall
-    int has_dot; // whether there is a dot in this position or not
-    int has_portal; // whether there is a portal in this position or not
-    pthread_mutex_t lock;
-} board_pos_t;
-
 typedef struct {
     int width, height; //dimensions of the board
-    board_pos_t* board; //actual board, most likely a row-major matrix
+    // The grid is row-major, cell index = y * width + x
+    char* cells; // occupancy, one byte per cell: ' ' empty, 'P' pacman, 'M' monster
+    uint64_t* walls; // bitsets with one bit per cell
+    uint64_t* dots;
+    uint64_t* portals;
+    // Occupancy by row and by column, for ray scans: bit x of row y (and bit y
+    // of column x) is set when the cell holds a wall, a ghost or a pacman
+    uint64_t* row_occupancy; // height rows of row_words words
+    uint64_t* col_occupancy; // width columns of col_words words
+    int row_words, col_words;
     int n_pacmans; //number of pacmans in the board
     pacman_t* pacmans; // array containing every pacman in the board to iterate through when processing
     int n_ghosts; //number of ghosts in the board
@@ -63,9 +80,19 @@ typedef struct {
     int victory; // flag set when all dots collected
     int game_over; // flag set when pacman dies
     int accumulated_points; // total collected points
-    pthread_rwlock_t state_lock;
+    int remaining_dots; // dots still on the board, set by read_level and kept by move_pacman
+    unsigned long version; // bumped on every change a client could see, never goes back
+    uint64_t rng; // xorshift64* state for random ('R') moves, never 0, see seed_board
 } board_t;
 
+/*
+Locking model: none. A board belongs to exactly one session, and only that
+session's step reads or writes it (ticks, rendering, level load/unload). The
+scheduler never runs a task on two workers at once, so every function below
+runs single-writer without taking a lock. Input from the host thread reaches
+the session through its own input queue, never through the board.
+*/
+
 /*Move pacman/monster in a certain direction on the board must check for boundaries, walls and other monsters
 Maybe do 1 function for pacman and 1 for monsters if required
 Maybe do 1 function for each direction
@@ -73,6 +100,26 @@ Maybe do 1 function for each direction
 int move_pacman(board_t* board, int pacman_index, command_t* command);
 int move_ghost(board_t* board, int ghost_index, command_t* command);
 
+/*Charged ghost move: slides in direction until the first wall or ghost (and
+stops before it) or pacman (and kills it), or the board edge. Uses the
+occupancy masks, so the cost does not depend on the distance travelled.*/
+int move_ghost_charged(board_t* board, int ghost_index, char direction);
+
+/*Advances the board by one tick. Update order is fixed so a level always plays
+out the same way: pacman 0 first (using pacman_cmd when it has no script,
+'\0' meaning no input), then ghosts in index order. An entity acts once
+every 1 + passo ticks, and of its acts its passo/waiting counter lets one in
+1 + passo move: PASSO 1 moves every 4 ticks, the pace it had when each entity
+slept tempo * (1 + passo) in a thread of its own. Stops early and sets victory/game_over as soon as the level is decided.*/
+void tick_board(board_t* board, char pacman_cmd);
+
+/*Writes the board as display-ready chars into out (width*height, no terminator).
+Static tiles are written for the whole grid first ('#' wall, '@' portal,
+'.' dot, ' ' empty), then entities are stamped on top from the pacmans and
+ghosts arrays: 'C' for a live pacman, 'M' for a ghost, 'G' if it is charged.
+Ghosts are stamped last so they hide a pacman on the same cell.*/
+void render_board(board_t* board, char* out);
+
 /*Remove an object (Pacman)*/
 void kill_pacman(board_t* board, int pacman_index);
 
@@ -83,6 +130,31 @@ int load_pacman(board_t* board);
 int load_ghost(board_t* board);
 
 
+/*Allocates cells (all empty), the wall/dot/portal bitsets and the occupancy
+masks (all clear) for board->width x board->height.
+Returns 0 on success, -1 on failure.*/
+int alloc_board_grid(board_t* board);
+void free_board_grid(board_t* board);
+
+/*Seeds the board's random move generator. Any seed is fine, 0 included; the
+same seed and the same inputs replay the same game. The state lives in the
+board, so sessions never share a generator.*/
+void seed_board(board_t* board, uint64_t seed);
+
+/*Next value of the board's generator (xorshift64*), uniform over 32 bits*/
+static inline uint32_t board_random(board_t* board) {
+    uint64_t x = board->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    board->rng = x;
+    return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/*Recomputes the occupancy masks from walls and cells. Needed after writing
+cells directly (parsers, level copies); the move functions keep them current.*/
+void rebuild_occupancy(board_t* board);
+
 /*
 Fils the board with the information coming from the file
 */
@@ -0,0 +1,83 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "board.h"
+#include "protocol.h"
+
+/*
+Server side of the board notifications. Remembers the last frame the client
+received so that only the cells that changed since then need to be sent
+(OP_CODE_BOARD_DELTA). A full frame (OP_CODE_BOARD) is sent first, whenever
+the dimensions change, and whenever it would be smaller than the delta.
+Nothing is sent while board->version stays the same, apart from a keepalive
+frame every keepalive_ms.
+With a shared memory region (frame_shm_open) frames that fit are written
+there instead, under its seqlock, and the pipe only carries a doorbell.
+The notification pipe is non-blocking and nothing waits on it. What a full
+pipe does not take of a frame is kept and written first on the next calls;
+a frame the pipe takes no byte of is skipped, and the next one goes in full.
+*/
+
+#define FRAME_MAX_MISSED 50 // calls in a row a client may take nothing before its session is dropped
+
+typedef struct {
+    int width, height; // dimensions of the last frame, 0 before the first one
+    char *last;        // last frame the client has
+    int synced;        // whether the client holds last, otherwise send in full
+    char *current;     // frame being built
+    char *msg;         // outgoing message buffer
+    int msg_cap;
+    unsigned long version; // board version of the last frame sent
+    long long sent_ms;     // when the last frame was sent
+    int keepalive_ms;      // resend an unchanged board this often, 0 never
+    int plays;             // plays handled so far, set by the session before each send
+    int plays_sent;        // plays in the last frame sent
+    shm_frame_t *shm;      // shared region, NULL when frames go through the pipe
+    char shm_name[48];
+    int shm_synced;        // the client's latest frame is the one in shm
+    int pending_off;       // msg[pending_off, +pending_len) is still to be written
+    int pending_len;
+    int missed;            // calls in a row the full pipe took nothing
+} frame_state_t;
+
+/*Serializes the board and writes a full or delta frame to the non-blocking
+notif_fd, unless the client already has this version of the board and play
+count. Returns 0 on success or skip, -1 on error with errno set: EAGAIN if
+the pipe was full and took nothing (counted in missed), EPIPE if the client
+left.*/
+int send_board_update(frame_state_t *fs, int notif_fd, board_t *board);
+
+/*Builds the next frame for the pipe in fs->msg and points msg at it, counting
+it as sent; full forces a full frame. Does not use the shared region.
+Returns the message size, 0 when the client already has this board (and
+full is not set), -1 if there is no memory for it.*/
+int frame_serialize(frame_state_t *fs, board_t *board, int full, const char **msg);
+
+/*Opens a client's notification FIFO as a non-blocking writer without
+waiting for the client to open its end. *hold gets a second fd on the FIFO
+that stands in for the reader until then, so early writes neither block nor
+fail with EPIPE; notif_release_hold closes it.
+Returns the writer, -1 on failure (with *hold -1).*/
+int notif_open(const char *path, int *hold);
+
+/*Closes *hold once the pipe is empty: the client has been reading, so its
+end is open and a later EPIPE really means it left. Does nothing when *hold
+is -1; cheap enough to call before every frame.*/
+void notif_release_hold(int fd, int *hold);
+
+/*Creates the session's shared memory region (SHM_NAME_FORMAT) and sends
+later frames through it. Returns 0 on success, -1 on failure, in which case
+frames keep going through the pipe.*/
+int frame_shm_open(frame_state_t *fs, int session_id, unsigned region);
+
+/*Unmaps and removes the shared memory region, if there is one*/
+void frame_shm_close(frame_state_t *fs);
+
+/*Forgets the last frame so that the next one is sent in full*/
+void frame_reset(frame_state_t *fs);
+
+/*Releases the buffers; the keepalive setting, the play count and the
+shared memory region stay*/
+void frame_free(frame_state_t *fs);
+
+#endif
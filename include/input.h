@@ -0,0 +1,51 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+Plays received for a session, in arrival order. The host thread is the only
+producer and the session's tick the only consumer, so the ring needs no lock:
+tail is written by the producer alone, head by the consumer and, when a full
+ring drops its oldest entry, by the producer with a compare-and-swap.
+Each slot packs the command with the time it arrived (microseconds on the
+monotonic clock) into one atomic word, so a slot read while it is being
+replaced is never torn.
+*/
+
+typedef enum {
+    INPUT_DROP_OLDEST, // a full ring forgets its oldest play to take the new one
+    INPUT_DROP_NEWEST, // a full ring ignores the new play
+} input_policy_t;
+
+typedef struct {
+    _Atomic uint64_t *slots; // (arrival_us << 8) | command
+    unsigned mask;           // capacity - 1, capacity a power of two
+    input_policy_t policy;
+    _Alignas(64) atomic_uint head; // next play to consume
+    _Alignas(64) atomic_uint tail; // next free slot
+    atomic_ulong dropped;          // plays lost to a full ring
+    // Kept by the consumer only
+    unsigned long consumed;
+    uint64_t delay_us_sum, delay_us_max; // arrival to consumption
+} input_queue_t;
+
+/*Sets up an empty ring holding at least depth plays.
+Returns 0 on success, -1 on failure.*/
+int input_queue_init(input_queue_t *q, int depth, input_policy_t policy);
+
+void input_queue_free(input_queue_t *q);
+
+/*Producer side: queues command, stamped with the current time.
+Returns 0 if it was queued, -1 if the ring was full and it was dropped.*/
+int input_queue_push(input_queue_t *q, char command);
+
+/*Consumer side: takes the oldest play into command and records how long it
+waited. Returns 1 if there was one, 0 if the ring is empty.*/
+int input_queue_pop(input_queue_t *q, char *command);
+
+/*Parses "oldest" or "newest". Returns 0 on success, -1 otherwise.*/
+int input_policy_parse(const char *name, input_policy_t *policy);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef LEVELS_H
+#define LEVELS_H
+
+#include "board.h"
+#include <stdatomic.h>
+
+/*
+Server-wide cache of parsed levels. Each level file is read and parsed once;
+the result is an immutable, reference-counted template (grid, pacman and
+ghost scripts, tempo) that sessions copy into their own board. Levels come
+from a directory of text files or from a binary pack compiled by levelc.
+*/
+
+typedef struct level {
+    char dirname[MAX_FILENAME];
+    char filename[MAX_FILENAME];
+    board_t board; // as loaded from disk, never modified afterwards
+    atomic_int refs; // the cache holds one reference
+    int mapped; // bitplanes point into the level pack instead of the heap
+    struct level *next; // cache bucket chaining
+} level_t;
+
+/*Returns a reference to the parsed level, parsing it on first use.
+NULL if the level cannot be loaded. Release it with level_release.*/
+level_t* level_cache_get(const char* dirname, const char* filename);
+
+void level_release(level_t* level);
+
+/*Fills board with a private copy of the level, ready to be played.
+Returns 0 on success, -1 on failure (nothing to unload).*/
+int level_instantiate(const level_t* level, board_t* board, int accumulated_points);
+
+/*Watches the directory dirname in the background: levels whose .lvl, .p or
+.m files change are parsed again and swapped in the cache, and the catalog is
+rebuilt. Sessions already playing keep the catalog they started with.
+Returns 0 if the watch is in place.*/
+int level_cache_watch(const char* dirname);
+
+/*Maps the level pack at path; from then on levels of dirname path are built
+from the pack. Returns 0 on success, -1 if path is not a valid pack.*/
+int level_cache_use_pack(const char* path);
+
+/*Sorted names of the .lvl files in the directory dirname, the order a
+session plays them in. *names gets an array of strings to release with
+level_list_free. Returns the number of names, -1 on error.*/
+int level_list(const char* dirname, char*** names);
+
+void level_list_free(char** names, int count);
+
+/*
+Sorted list of the level files of the levels directory (or pack), each with a
+reference to its parsed template. It is built at startup and rebuilt when
+levels are written, renamed or removed; each rebuild is a new catalog, so a
+session holding a reference plays the levels, and the versions of them, it
+started with, whatever happens to the files meanwhile.
+*/
+typedef struct {
+    char dirname[MAX_FILENAME];
+    int count;
+    char **names;     // sorted level file names
+    level_t **levels; // levels[i] is the template of names[i]
+    atomic_int refs;
+} level_catalog_t;
+
+/*Builds the catalog of dirname (a directory or the pack in use), parsing
+the levels not cached yet, and makes it current. Levels that fail to load
+are left out. Returns the number of levels, -1 on error.*/
+int level_catalog_load(const char* dirname);
+
+/*Reference to the current catalog, NULL if none was loaded*/
+level_catalog_t* level_catalog_get(void);
+
+void level_catalog_release(level_catalog_t* catalog);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include "board.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Binary level pack written by levelc from a levels directory. Everything the
+text files describe is stored ready to use, so the server maps the file and
+builds boards without parsing. Integers are in host byte order and every
+record starts 8-byte aligned, so bitplanes can be used in place.
+
+    pack_header_t
+    pack_entry_t[n_levels]      sorted by name
+    level records, each one:
+        pack_level_t
+        uint64_t walls[words], dots[words], portals[words]   words = BITSET_WORDS(width * height)
+        pack_agent_t pacmans[n_pacmans], ghosts[n_ghosts]
+*/
+
+#define PACK_MAGIC "PMPK"
+#define PACK_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t n_levels;
+    uint32_t reserved;
+} pack_header_t;
+
+typedef struct {
+    char name[MAX_FILENAME]; // level file it was compiled from, e.g. "1.lvl"
+    uint64_t offset; // of the level record, from the start of the pack
+    uint64_t size; // of the whole level record
+} pack_entry_t;
+
+typedef struct {
+    int32_t width, height;
+    int32_t tempo;
+    int32_t n_pacmans, n_ghosts;
+    int32_t remaining_dots;
+    char level_name[MAX_FILENAME];
+} pack_level_t;
+
+typedef struct {
+    int32_t command;
+    int32_t turns;
+} pack_move_t;
+
+// Starting state and move program of a pacman or ghost
+typedef struct {
+    int32_t pos_x, pos_y;
+    int32_t passo;
+    int32_t n_moves;
+    pack_move_t moves[MAX_MOVES];
+} pack_agent_t;
+
+// Keep records a multiple of 8 bytes so bitplanes stay aligned
+_Static_assert(sizeof(pack_level_t) % 8 == 0, "pack_level_t must keep bitplanes aligned");
+_Static_assert(sizeof(pack_agent_t) % 8 == 0, "pack_agent_t must keep records aligned");
+_Static_assert(sizeof(pack_entry_t) % 8 == 0, "pack_entry_t must keep records aligned");
+
+typedef struct {
+    void *map;
+    size_t size;
+    const pack_header_t *header;
+    const pack_entry_t *entries;
+} pack_t;
+
+/*Maps a pack read-only and checks its layout. Returns 0 on success.*/
+int pack_open(pack_t *pack, const char *path);
+
+void pack_close(pack_t *pack);
+
+/*Level record compiled from the file called name, NULL if there is none*/
+const pack_level_t *pack_find(const pack_t *pack, const char *name);
+
+/*Bitplanes and agents that follow a level record*/
+static inline const uint64_t *pack_bitplanes(const pack_level_t *level) {
+    return (const uint64_t *)(level + 1);
+}
+
+static inline const pack_agent_t *pack_agents(const pack_level_t *level) {
+    int words = BITSET_WORDS(level->width * level->height);
+    return (const pack_agent_t *)(pack_bitplanes(level) + 3 * words);
+}
+
+static inline size_t pack_level_size(int width, int height, int n_agents) {
+    return sizeof(pack_level_t) + 3 * BITSET_WORDS(width * height) * sizeof(uint64_t) +
+           n_agents * sizeof(pack_agent_t);
+}
+
+#endif
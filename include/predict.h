@@ -0,0 +1,41 @@
+#ifndef PREDICT_H
+#define PREDICT_H
+
+#include "api.h"
+
+/*
+Client-side prediction of the player's own pacman ('C'). A play is applied
+to the last board from the server as soon as it is sent, so the key shows up
+on the next draw instead of after the server's tick. Every server board
+replaces the prediction: the plays it already reflects (Board.plays) are
+forgotten and the rest are applied again on top of it.
+Only steps into empty cells and dots are predicted. Walls, ghosts and portals
+are left for the server, so no game rule runs on the client and a wrong
+guess lasts one frame at most.
+*/
+
+#define PREDICT_MAX_PENDING 64 // plays in flight; older ones stop being predicted
+
+typedef struct {
+    Board board; // last board from the server, data pointing at shown
+    char *shown; // its cells with the pending plays applied
+    int cap;
+    int plays_sent;  // plays sent this session
+    int plays_acked; // plays the last server board reflects
+    char pending[PREDICT_MAX_PENDING]; // play n at pending[n % PREDICT_MAX_PENDING]
+} predictor_t;
+
+/*Takes a board from the server and applies the plays it does not reflect yet.
+Returns 0 on success, -1 if there is no memory for it.*/
+int predict_board(predictor_t *p, Board board);
+
+/*Records a play that was just sent and applies it to the shown board*/
+void predict_play(predictor_t *p, char command);
+
+/*Board to draw: the last server board with the predicted moves. Its data
+belongs to the predictor and changes with the next call.*/
+Board predict_view(const predictor_t *p);
+
+void predict_free(predictor_t *p);
+
+#endif
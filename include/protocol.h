@@ -3,11 +3,100 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include <stdatomic.h>
+#include <stdint.h>
+
 enum {
   OP_CODE_CONNECT = 1,
   OP_CODE_DISCONNECT = 2,
   OP_CODE_PLAY = 3,
   OP_CODE_BOARD = 4,
+  OP_CODE_BOARD_DELTA = 5,
+  OP_CODE_BOARD_SHM = 6,
+  OP_CODE_SPECTATE = 7,
+  OP_CODE_CONNECT_EXT = 8,
 };
 
-#endif
\ No newline at end of file
+// Every message on the registration FIFO is as long as its opcode says
+// (registration_size), so back to back messages never need a read to end
+// where one does.
+// OP_CODE_CONNECT: opcode + request pipe + notification pipe (both NUL padded
+// to MAX_PIPE_PATH_LENGTH). The server picks the seed for the session's
+// random moves; the response is opcode and result.
+#define CONNECT_MESSAGE_SIZE (1 + 2 * MAX_PIPE_PATH_LENGTH)
+#define CONNECT_RESPONSE_SIZE 2
+// OP_CODE_CONNECT_EXT: the same, then a uint64_t seed (0 lets the server pick
+// one) and a uint32_t of CONNECT_FLAG_*. The response is opcode, result, the
+// flags the server granted and a uint32_t region number (see SHM_NAME_FORMAT).
+#define CONNECT_EXT_MESSAGE_SIZE (CONNECT_MESSAGE_SIZE + 8 + 4)
+#define CONNECT_EXT_RESPONSE_SIZE (3 + 4)
+#define CONNECT_FLAG_SHM 1 // frames through shared memory, see shm_frame_t
+
+// OP_CODE_SPECTATE, on the registration FIFO: opcode + notification pipe (NUL
+// padded to MAX_PIPE_PATH_LENGTH) + int32_t id of the session to watch.
+// The response is opcode and result (0, or 1 if there is no such session),
+// then the session's board frames follow on the pipe like a player's, always
+// through the pipe. A spectator has no request pipe and sends nothing; it
+// leaves by closing its notification pipe.
+#define SPECTATE_MESSAGE_SIZE (1 + MAX_PIPE_PATH_LENGTH + 4)
+#define SPECTATE_RESPONSE_SIZE 2
+#define MAX_REGISTRATION_SIZE CONNECT_EXT_MESSAGE_SIZE
+
+/* Length of the registration message that starts with opcode, 0 if none does */
+static inline int registration_size(char opcode) {
+  switch (opcode) {
+  case OP_CODE_CONNECT: return CONNECT_MESSAGE_SIZE;
+  case OP_CODE_CONNECT_EXT: return CONNECT_EXT_MESSAGE_SIZE;
+  case OP_CODE_SPECTATE: return SPECTATE_MESSAGE_SIZE;
+  default: return 0;
+  }
+}
+
+// Requests on a session's request pipe follow each other with no separator,
+// each one as long as its opcode says; a read may end in the middle of one.
+#define PLAY_MESSAGE_SIZE 2       // opcode + command
+#define DISCONNECT_MESSAGE_SIZE 1 // opcode only
+#define MAX_REQUEST_SIZE PLAY_MESSAGE_SIZE
+
+/* Length of the request that starts with opcode, 0 if no request does */
+static inline int request_size(char opcode) {
+  switch (opcode) {
+  case OP_CODE_PLAY: return PLAY_MESSAGE_SIZE;
+  case OP_CODE_DISCONNECT: return DISCONNECT_MESSAGE_SIZE;
+  default: return 0;
+  }
+}
+
+// Board frames start with the opcode and seven ints:
+// width, height, tempo, victory, game_over, accumulated_points, plays.
+// plays counts the OP_CODE_PLAY requests the session has taken from its
+// input queue (applied or dropped), so a predicting client knows which of
+// its own plays the frame already reflects.
+#define BOARD_HEADER_SIZE (1 + 4 * 7)
+
+// OP_CODE_BOARD: header + width*height cells.
+// OP_CODE_BOARD_DELTA: header + int count + count * (int index, char cell),
+// applied on top of the previous frame.
+#define DELTA_ENTRY_SIZE (4 + 1)
+
+// OP_CODE_BOARD_SHM: a doorbell, just a header; the frame itself is in the
+// session's shared memory region, named SHM_NAME_FORMAT with the client id
+// and the region number from the connect response, so a reconnecting client
+// never meets the region of its previous session. Boards too big for the
+// region still go through the pipe.
+#define SHM_NAME_FORMAT "/pacmanist_%d_%u"
+#define SHM_FRAME_CAP (256 * 1024) // cells the region holds
+
+// The region is a seqlock around one frame: seq is odd while the server
+// writes, and a reader that saw it odd or changed copies again. header holds
+// the same seven ints as a board frame, cells the width*height board.
+typedef struct {
+  _Atomic uint32_t seq;
+  uint32_t cap; // bytes in cells
+  int32_t header[7];
+  char cells[];
+} shm_frame_t;
+
+#define SHM_REGION_SIZE (sizeof(shm_frame_t) + SHM_FRAME_CAP)
+
+#endif
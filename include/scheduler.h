@@ -0,0 +1,32 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/*
+Worker pool that multiplexes many periodic tasks (game sessions) over a few
+threads. Tasks wait in a timer wheel until they are due, are then handed to a
+worker's run queue, and idle workers steal from busy ones.
+*/
+
+/*Runs one step of a task. Returns the delay in ms until the next step, or -1
+when the task is finished (the task may free itself before returning -1).
+A task sits in exactly one place at a time (timer wheel, run queue or a
+running worker), so two steps of the same task never overlap.*/
+typedef int (*task_fn)(void *arg);
+
+typedef struct task {
+    task_fn run;
+    void *arg;
+    uint64_t due_tick; // timer wheel tick at which the task becomes runnable
+    struct task *next; // timer wheel slot chaining
+} task_t;
+
+/*Starts n_workers workers (number of online cores when n_workers <= 0)
+and the timer thread. Returns the number of workers started, -1 on error.*/
+int scheduler_start(int n_workers);
+
+/*Schedules task->run(task->arg) to be called in delay_ms milliseconds*/
+void scheduler_submit(task_t *task, int delay_ms);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include "board.h"
+#include "frame.h"
+
+/*
+Read-only spectators of a session (OP_CODE_SPECTATE). All of them share one
+frame stream: each tick the board is serialized once and the same buffer is
+written to every spectator's notification pipe, so a tick costs one render
+plus one write per spectator however many are watching.
+The pipes are non-blocking and a frame that does not fit whole in one is
+skipped for that spectator, so a slow spectator never holds up the tick. The
+next frame to anyone is then a full one, since the one it missed may have
+been the base of a delta; a spectator that misses SPECTATOR_MAX_MISSED frames
+in a row is dropped.
+The host thread adds spectators, the session's tick owns them after that.
+*/
+
+#define SPECTATOR_MAX_MISSED 50 // frames in a row a spectator may skip before it is dropped
+
+typedef struct spectator {
+    int fd;       // notification pipe, non-blocking
+    int hold;     // stands in for the reader until the spectator reads, see notif_open; -1 once released
+    int capacity; // bytes the pipe holds
+    int missed;   // frames skipped in a row
+    struct spectator *next;
+} spectator_t;
+
+typedef struct {
+    _Atomic(spectator_t *) joining; // pushed by the host thread, taken by the tick
+    spectator_t *list;              // the tick's alone
+    int count;
+    int stale;            // someone joined or missed a frame, send the next one in full
+    frame_state_t frames; // the shared stream, keepalive and plays set like the player's
+    // Kept by the tick, for the log
+    unsigned long frames_sent, writes, skipped, dropped;
+} spectators_t;
+
+/*Host thread: hands notif_fd, and the hold notif_open gave with it (-1 if
+none), over to the session; notif_fd is made non-blocking and gets the
+frames from the next tick on. Returns 0 on success, -1 on failure, in which
+case both are left to the caller.*/
+int spectators_add(spectators_t *s, int notif_fd, int hold);
+
+/*Session tick: sends board to every spectator, serialized once. Costs
+nothing while nobody watches.*/
+void spectators_publish(spectators_t *s, board_t *board);
+
+/*Closes every spectator's pipe and releases the stream, once the tick has
+stopped for good*/
+void spectators_close(spectators_t *s);
+
+#endif
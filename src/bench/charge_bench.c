@@ -0,0 +1,184 @@
+#include "board.h"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+Charged ghost moves: the old cell-by-cell scan against move_ghost_charged,
+which finds the first obstacle with bit scans over the occupancy masks.
+Both are first checked to agree on random boards, then timed on a corridor
+the ghost charges back and forth across, for growing widths.
+*/
+
+// The charge move_ghost used before the occupancy masks (only writes cells)
+static int legacy_charge(board_t *board, int ghost_index, char direction) {
+    ghost_t *ghost = &board->ghosts[ghost_index];
+    int x = ghost->pos_x, y = ghost->pos_y;
+    int new_x = x, new_y = y;
+    int dx = 0, dy = 0;
+    int limit;
+
+    ghost->charged = 0;
+    switch (direction) {
+        case 'W': dy = -1; limit = y; break;
+        case 'S': dy = 1; limit = board->height - 1 - y; break;
+        case 'A': dx = -1; limit = x; break;
+        case 'D': dx = 1; limit = board->width - 1 - x; break;
+        default: return INVALID_MOVE;
+    }
+    if (limit == 0) return INVALID_MOVE;
+
+    int result = VALID_MOVE;
+    new_x = x + dx * limit; // In case there is no colision
+    new_y = y + dy * limit;
+    for (int i = 1; i <= limit; i++) {
+        int cx = x + dx * i, cy = y + dy * i;
+        int idx = cy * board->width + cx;
+        if (bit_test(board->walls, idx) || board->cells[idx] == 'M') {
+            new_x = cx - dx;
+            new_y = cy - dy;
+            break;
+        } else if (board->cells[idx] == 'P') {
+            new_x = cx;
+            new_y = cy;
+            board->cells[idx] = ' ';
+            board->pacmans[0].alive = 0;
+            result = DEAD_PACMAN;
+            break;
+        }
+    }
+
+    board->cells[y * board->width + x] = ' ';
+    ghost->pos_x = new_x;
+    ghost->pos_y = new_y;
+    board->cells[new_y * board->width + new_x] = 'M';
+    return result;
+}
+
+static void make_board(board_t *board, int width, int height, int n_ghosts) {
+    memset(board, 0, sizeof(*board));
+    board->width = width;
+    board->height = height;
+    if (alloc_board_grid(board) != 0) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    board->n_pacmans = 1;
+    board->pacmans = calloc(1, sizeof(pacman_t));
+    board->n_ghosts = n_ghosts;
+    board->ghosts = calloc(n_ghosts, sizeof(ghost_t));
+}
+
+static void free_board(board_t *board) {
+    free_board_grid(board);
+    free(board->pacmans);
+    free(board->ghosts);
+}
+
+// Random walls, ghosts and one pacman on free cells
+static void fill_random(board_t *board) {
+    int cells = board->width * board->height;
+    for (int i = 0; i < cells; i++) {
+        if (rand() % 5 == 0) bit_set(board->walls, i);
+    }
+    for (int g = 0; g <= board->n_ghosts; g++) {
+        int idx;
+        do idx = rand() % cells; while (bit_test(board->walls, idx) || board->cells[idx] != ' ');
+        int x = idx % board->width, y = idx / board->width;
+        if (g < board->n_ghosts) {
+            board->ghosts[g].pos_x = x;
+            board->ghosts[g].pos_y = y;
+            board->cells[idx] = 'M';
+        } else {
+            board->pacmans[0].pos_x = x;
+            board->pacmans[0].pos_y = y;
+            board->pacmans[0].alive = 1;
+            board->cells[idx] = 'P';
+        }
+    }
+    rebuild_occupancy(board);
+}
+
+static int check_agreement(void) {
+    const char dirs[] = "WASD";
+    for (int round = 0; round < 200; round++) {
+        int width = 2 + rand() % 150, height = 2 + rand() % 40;
+        int n_ghosts = 1 + rand() % 8;
+        if (n_ghosts + 1 > width * height / 2) continue;
+
+        board_t a, b;
+        make_board(&a, width, height, n_ghosts);
+        make_board(&b, width, height, n_ghosts);
+        fill_random(&a);
+        memcpy(b.cells, a.cells, width * height);
+        memcpy(b.walls, a.walls, 3 * BITSET_WORDS(width * height) * sizeof(uint64_t));
+        memcpy(b.pacmans, a.pacmans, sizeof(pacman_t));
+        memcpy(b.ghosts, a.ghosts, n_ghosts * sizeof(ghost_t));
+        rebuild_occupancy(&b);
+
+        for (int step = 0; step < 50 && a.pacmans[0].alive; step++) {
+            int g = rand() % n_ghosts;
+            char dir = dirs[rand() % 4];
+            int ra = legacy_charge(&a, g, dir);
+            int rb = move_ghost_charged(&b, g, dir);
+            if (ra != rb || a.ghosts[g].pos_x != b.ghosts[g].pos_x ||
+                a.ghosts[g].pos_y != b.ghosts[g].pos_y ||
+                memcmp(a.cells, b.cells, width * height) != 0) {
+                fprintf(stderr, "charges disagree on a %dx%d board, ghost %d going %c\n", width, height, g, dir);
+                return -1;
+            }
+        }
+        free_board(&a);
+        free_board(&b);
+    }
+    return 0;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Average microseconds per charge, the ghost going back and forth for ~100 ms
+static double time_charges(int (*charge)(board_t *, int, char), board_t *board) {
+    int charges = 0;
+    double start = now_us();
+    double elapsed;
+    do {
+        for (int i = 0; i < 64; i++) charge(board, 0, i % 2 ? 'A' : 'D');
+        charges += 64;
+        elapsed = now_us() - start;
+    } while (elapsed < 100000);
+    return elapsed / charges;
+}
+
+int main(void) {
+    open_debug_file("/dev/null");
+    srand(1);
+    if (check_agreement() != 0) return 1;
+
+    int widths[] = {16, 64, 256, 1024, 4096, 16384};
+    int n_widths = sizeof(widths) / sizeof(widths[0]);
+
+    printf("corridor charges, microseconds per charge\n");
+    printf("%8s %12s %12s %9s\n", "width", "cell scan", "bit scan", "speedup");
+    for (int i = 0; i < n_widths; i++) {
+        int width = widths[i];
+        board_t board;
+        make_board(&board, width, 1, 1);
+        board.ghosts[0].pos_x = 0;
+        board.cells[0] = 'M';
+        rebuild_occupancy(&board);
+
+        double t_legacy = time_charges(legacy_charge, &board);
+        double t_bits = time_charges(move_ghost_charged, &board);
+        printf("%8d %12.3f %12.3f %8.1fx\n", width, t_legacy, t_bits, t_legacy / t_bits);
+        free_board(&board);
+    }
+
+    close_debug_file();
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include "board.h"
+#include "parser.h"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+/*
+Level load time: the old parser that reads one byte per read() call, against
+read_level, on generated levels of growing size. The old parser cuts lines at
+255 chars, so it is skipped on wider boards.
+Usage: parser_bench [tmp_dir]
+*/
+
+#define LEGACY_LINE_LENGTH 256
+
+// The line reader read_level used before the whole-file buffer
+static int legacy_read_line(int fd, char *buf) {
+    int i = 0;
+    char c;
+    ssize_t n;
+
+    while ((n = read(fd, &c, 1)) == 1) {
+        if (c == '\r') continue;
+        if (c == '\n') break;
+        buf[i++] = c;
+        if (i == LEGACY_LINE_LENGTH - 1) break;
+    }
+
+    buf[i] = '\0';
+    if (n == -1) return -1;
+    if (n == 0 && i == 0) return 0;
+    return i;
+}
+
+// Header and grid parsing of the old read_level, on top of legacy_read_line
+static int legacy_read_level(board_t *board, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+
+    char command[LEGACY_LINE_LENGTH];
+    int read;
+    while ((read = legacy_read_line(fd, command)) > 0) {
+        if (command[0] == '#' || command[0] == '\0') continue;
+        if (strncmp(command, "DIM ", 4) == 0) {
+            sscanf(command + 4, "%d %d", &board->width, &board->height);
+        } else if (strncmp(command, "TEMPO ", 6) == 0) {
+            board->tempo = atoi(command + 6);
+        } else {
+            break;
+        }
+    }
+
+    if (!board->width || !board->height || alloc_board_grid(board) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    int row = 0;
+    while (read > 0 && row < board->height) {
+        for (int col = 0; col < board->width; col++) {
+            int idx = row * board->width + col;
+            switch (command[col]) {
+                case 'X': bit_set(board->walls, idx); break;
+                case '@': bit_set(board->portals, idx); break;
+                default:
+                    bit_set(board->dots, idx);
+                    board->remaining_dots++;
+                    break;
+            }
+        }
+        row++;
+        read = legacy_read_line(fd, command);
+    }
+
+    close(fd);
+    return read == -1 ? -1 : 0;
+}
+
+static int new_read_level(board_t *board, const char *dir, const char *file) {
+    int res = read_level(board, (char *)file, (char *)dir);
+    free(board->pacmans);
+    free(board->ghosts);
+    return res;
+}
+
+// Walled border, inner wall every fourth row with a gap, one portal
+static int write_level(const char *path, int width, int height) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "# generated by parser_bench\nDIM %d %d\nTEMPO 100\n", width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            char c = 'o';
+            if (x == 0 || y == 0 || x == width - 1 || y == height - 1) c = 'X';
+            else if (y % 4 == 0 && x % 16 != 1) c = 'X';
+            else if (x == width - 2 && y == height - 2) c = '@';
+            fputc(c, f);
+        }
+        fputc('\n', f);
+    }
+    return fclose(f);
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int same_grid(board_t *a, board_t *b) {
+    if (a->width != b->width || a->height != b->height) return 0;
+    if (a->remaining_dots != b->remaining_dots) return 0;
+    size_t words = 3 * (size_t)BITSET_WORDS(a->width * a->height);
+    return memcmp(a->walls, b->walls, words * sizeof(uint64_t)) == 0;
+}
+
+int main(int argc, char **argv) {
+    char dir[MAX_FILENAME];
+    snprintf(dir, sizeof(dir), "%s/parser_bench.XXXXXX", argc > 1 ? argv[1] : "/tmp");
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    open_debug_file("/dev/null"); // read_level echoes every row
+
+    int sizes[][2] = {{20, 20}, {100, 100}, {250, 250}, {250, 2000}, {1000, 1000}, {4000, 1000}};
+    int n_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    int status = 0;
+
+    printf("milliseconds per level load\n");
+    printf("%11s %12s %12s %9s\n", "board", "byte-read", "buffered", "speedup");
+    for (int i = 0; i < n_sizes && status == 0; i++) {
+        int width = sizes[i][0], height = sizes[i][1];
+        char file[64], path[2 * MAX_FILENAME];
+        snprintf(file, sizeof(file), "%dx%d.lvl", width, height);
+        snprintf(path, sizeof(path), "%s/%s", dir, file);
+        if (write_level(path, width, height) != 0) {
+            perror("write level");
+            status = 1;
+            break;
+        }
+
+        // Repeat each parser until ~100 ms have passed
+        board_t board;
+        int loads = 0;
+        double start = now_us(), elapsed;
+        do {
+            memset(&board, 0, sizeof(board));
+            if (new_read_level(&board, dir, file) != 0) {
+                fprintf(stderr, "read_level failed on %s\n", file);
+                status = 1;
+                break;
+            }
+            free_board_grid(&board);
+            loads++;
+            elapsed = now_us() - start;
+        } while (elapsed < 100000);
+        if (status != 0) break;
+        double t_new = elapsed / loads / 1000;
+
+        if (width >= LEGACY_LINE_LENGTH) {
+            printf("%5dx%-5d %12s %12.3f %9s\n", width, height, "-", t_new, "-");
+            unlink(path);
+            continue;
+        }
+
+        // Both parsers must build the same grid
+        board_t legacy, fresh;
+        memset(&legacy, 0, sizeof(legacy));
+        memset(&fresh, 0, sizeof(fresh));
+        if (legacy_read_level(&legacy, path) != 0 || new_read_level(&fresh, dir, file) != 0 ||
+            !same_grid(&legacy, &fresh)) {
+            fprintf(stderr, "parsers disagree on %s\n", file);
+            status = 1;
+        }
+        free_board_grid(&legacy);
+        free_board_grid(&fresh);
+        if (status != 0) break;
+
+        loads = 0;
+        start = now_us();
+        do {
+            memset(&legacy, 0, sizeof(legacy));
+            legacy_read_level(&legacy, path);
+            free_board_grid(&legacy);
+            loads++;
+            elapsed = now_us() - start;
+        } while (elapsed < 100000);
+        double t_legacy = elapsed / loads / 1000;
+
+        printf("%5dx%-5d %12.3f %12.3f %8.1fx\n", width, height, t_legacy, t_new, t_legacy / t_new);
+        unlink(path);
+    }
+
+    rmdir(dir);
+    close_debug_file();
+    return status;
+}
@@ -0,0 +1,144 @@
+#include "board.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+Frame serialization cost as a function of ghost count: the old renderer that
+scans every ghost and pacman for every cell, against render_board.
+Usage: render_bench [width] [height]
+*/
+
+// The renderer send_board_update used before render_board
+static void legacy_render(board_t *board, char *out_frame) {
+    for (int y = 0; y < board->height; y++) {
+        for (int x = 0; x < board->width; x++) {
+            int idx = y * board->width + x;
+
+            char out = ' ';
+
+            for (int g = 0; g < board->n_ghosts; g++) {
+                ghost_t *gh = &board->ghosts[g];
+                if (gh->pos_x == x && gh->pos_y == y) {
+                    out = gh->charged ? 'G' : 'M';
+                    goto cell_done;
+                }
+            }
+
+            for (int p = 0; p < board->n_pacmans; p++) {
+                pacman_t *pc = &board->pacmans[p];
+                if (pc->alive && pc->pos_x == x && pc->pos_y == y) {
+                    out = 'C';
+                    goto cell_done;
+                }
+            }
+
+            if (bit_test(board->walls, idx)) {
+                out = '#';
+            } else if (bit_test(board->portals, idx)) {
+                out = '@';
+            } else if (bit_test(board->dots, idx)) {
+                out = '.';
+            } else {
+                out = ' ';
+            }
+
+cell_done:
+            out_frame[idx] = out;
+        }
+    }
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Average microseconds per frame over enough frames to fill ~100 ms
+static double time_renderer(void (*render)(board_t *, char *), board_t *board, char *out) {
+    int frames = 0;
+    double start = now_us();
+    double elapsed;
+    do {
+        for (int i = 0; i < 16; i++) render(board, out);
+        frames += 16;
+        elapsed = now_us() - start;
+    } while (elapsed < 100000);
+    return elapsed / frames;
+}
+
+int main(int argc, char **argv) {
+    int width = argc > 1 ? atoi(argv[1]) : 100;
+    int height = argc > 2 ? atoi(argv[2]) : 100;
+    if (width < 3 || height < 3) {
+        fprintf(stderr, "Usage: %s [width] [height]\n", argv[0]);
+        return 1;
+    }
+
+    int ghost_counts[] = {0, 1, 5, 10, 25, 50, 100};
+    int n_counts = sizeof(ghost_counts) / sizeof(ghost_counts[0]);
+    int max_ghosts = ghost_counts[n_counts - 1];
+
+    board_t board;
+    memset(&board, 0, sizeof(board));
+    board.width = width;
+    board.height = height;
+    alloc_board_grid(&board);
+    board.n_pacmans = 1;
+    board.pacmans = calloc(1, sizeof(pacman_t));
+    board.ghosts = calloc(max_ghosts, sizeof(ghost_t));
+    char *legacy = malloc(width * height);
+    char *overlay = malloc(width * height);
+    if (!board.cells || !board.pacmans || !board.ghosts || !legacy || !overlay) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    // Walled border, dots inside, one portal
+    srand(1);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int idx = y * width + x;
+            if (x == 0 || y == 0 || x == width - 1 || y == height - 1) {
+                bit_set(board.walls, idx);
+            } else {
+                bit_set(board.dots, idx);
+            }
+        }
+    }
+    bit_set(board.portals, width + width - 2);
+    board.pacmans[0].alive = 1;
+    board.pacmans[0].pos_x = 1;
+    board.pacmans[0].pos_y = 1;
+    for (int g = 0; g < max_ghosts; g++) {
+        board.ghosts[g].pos_x = 1 + rand() % (width - 2);
+        board.ghosts[g].pos_y = 1 + rand() % (height - 2);
+        board.ghosts[g].charged = g % 3 == 0;
+    }
+
+    printf("board %dx%d, microseconds per frame\n", width, height);
+    printf("%8s %12s %12s %9s\n", "ghosts", "per-cell", "overlay", "speedup");
+    for (int i = 0; i < n_counts; i++) {
+        board.n_ghosts = ghost_counts[i];
+
+        legacy_render(&board, legacy);
+        render_board(&board, overlay);
+        if (memcmp(legacy, overlay, width * height) != 0) {
+            fprintf(stderr, "renderers disagree with %d ghosts\n", board.n_ghosts);
+            return 1;
+        }
+
+        double t_legacy = time_renderer(legacy_render, &board, legacy);
+        double t_overlay = time_renderer(render_board, &board, overlay);
+        printf("%8d %12.2f %12.2f %8.1fx\n", board.n_ghosts, t_legacy, t_overlay, t_legacy / t_overlay);
+    }
+
+    free(legacy);
+    free(overlay);
+    free_board_grid(&board);
+    free(board.pacmans);
+    free(board.ghosts);
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "board.h"
+#include "frame.h"
+#include "spectate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/*
+Cost of a tick's frame for a session with N spectators: serialized once and
+the same buffer written to every pipe (spectators_publish), against one
+frame_state_t per spectator, each rendering and diffing the board on its own
+(send_board_update per spectator). Every tick some ghosts move, so each one
+sends a delta. The pipes are drained between ticks, outside the timing.
+Then the same run with one spectator that never reads, to show it costs the
+others nothing.
+Usage: spectate_bench [width] [height] [ticks]
+*/
+
+#define MAX_SPECTATORS 100
+#define N_GHOSTS 8
+#define STALL_TICKS 2000
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Walled border, dots inside, a few ghosts
+static int make_board(board_t *board, int width, int height) {
+    memset(board, 0, sizeof(*board));
+    board->width = width;
+    board->height = height;
+    if (alloc_board_grid(board) != 0) return -1;
+    board->n_pacmans = 1;
+    board->pacmans = calloc(1, sizeof(pacman_t));
+    board->n_ghosts = N_GHOSTS;
+    board->ghosts = calloc(N_GHOSTS, sizeof(ghost_t));
+    if (!board->pacmans || !board->ghosts) return -1;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int idx = y * width + x;
+            if (x == 0 || y == 0 || x == width - 1 || y == height - 1) {
+                bit_set(board->walls, idx);
+            } else {
+                bit_set(board->dots, idx);
+            }
+        }
+    }
+    board->pacmans[0].alive = 1;
+    board->pacmans[0].pos_x = 1;
+    board->pacmans[0].pos_y = 1;
+    for (int g = 0; g < N_GHOSTS; g++) {
+        board->ghosts[g].pos_x = 1 + g * (width - 2) / N_GHOSTS;
+        board->ghosts[g].pos_y = 1 + g * (height - 2) / N_GHOSTS;
+    }
+    return 0;
+}
+
+// Every ghost one step right, wrapping inside the walls, and a new version
+static void step_board(board_t *board) {
+    for (int g = 0; g < board->n_ghosts; g++) {
+        ghost_t *ghost = &board->ghosts[g];
+        ghost->pos_x = ghost->pos_x + 1 < board->width - 1 ? ghost->pos_x + 1 : 1;
+    }
+    board->version++;
+}
+
+static void drain(int fd) {
+    char buf[65536];
+    while (read(fd, buf, sizeof(buf)) > 0);
+}
+
+typedef struct {
+    double fanout_us, serialize_us, each_us; // per tick
+    unsigned long skipped, dropped;
+} result_t;
+
+static result_t run(board_t *board, int (*pipes)[2], int n, int stalled, int ticks) {
+    result_t res = {0};
+
+    // Serialize once, write to all
+    spectators_t s;
+    memset(&s, 0, sizeof(s));
+    for (int i = 0; i < n; i++) {
+        spectators_add(&s, dup(pipes[i][1]), -1);
+    }
+    frame_state_t shadow; // the serialization alone, to see its share
+    memset(&shadow, 0, sizeof(shadow));
+    const char *msg;
+    for (int t = 0; t < ticks; t++) {
+        step_board(board);
+        double t0 = now_us();
+        frame_serialize(&shadow, board, 0, &msg);
+        double t1 = now_us();
+        spectators_publish(&s, board);
+        double t2 = now_us();
+        res.serialize_us += t1 - t0;
+        res.fanout_us += t2 - t1;
+        for (int i = stalled; i < n; i++) drain(pipes[i][0]);
+    }
+    res.skipped = s.skipped;
+    res.dropped = s.dropped;
+    spectators_close(&s);
+    frame_free(&shadow);
+    for (int i = 0; i < n; i++) drain(pipes[i][0]);
+
+    // One stream per spectator
+    frame_state_t *each = calloc(n, sizeof(frame_state_t));
+    for (int t = 0; t < ticks && each; t++) {
+        step_board(board);
+        double t0 = now_us();
+        for (int i = stalled; i < n; i++) send_board_update(&each[i], pipes[i][1], board);
+        res.each_us += now_us() - t0;
+        for (int i = stalled; i < n; i++) drain(pipes[i][0]);
+    }
+    for (int i = 0; i < n && each; i++) frame_free(&each[i]);
+    free(each);
+
+    res.fanout_us /= ticks;
+    res.serialize_us /= ticks;
+    res.each_us /= ticks;
+    return res;
+}
+
+int main(int argc, char **argv) {
+    int width = argc > 1 ? atoi(argv[1]) : 100;
+    int height = argc > 2 ? atoi(argv[2]) : 100;
+    int ticks = argc > 3 ? atoi(argv[3]) : 500;
+    if (width < 3 || height < 3 || ticks <= 0) {
+        fprintf(stderr, "Usage: %s [width] [height] [ticks]\n", argv[0]);
+        return 1;
+    }
+
+    board_t board;
+    if (make_board(&board, width, height) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    int pipes[MAX_SPECTATORS][2];
+    for (int i = 0; i < MAX_SPECTATORS; i++) {
+        if (pipe(pipes[i]) == -1) {
+            perror("pipe");
+            return 1;
+        }
+        fcntl(pipes[i][0], F_SETFL, O_NONBLOCK);
+        fcntl(pipes[i][1], F_SETFL, O_NONBLOCK);
+    }
+
+    int counts[] = {1, 2, 5, 10, 25, 50, 100};
+    int n_counts = sizeof(counts) / sizeof(counts[0]);
+
+    printf("board %dx%d, %d ghosts moving, %d ticks, microseconds per tick\n", width, height, N_GHOSTS, ticks);
+    printf("%11s %12s %12s %12s %9s\n", "spectators", "fan-out", "serialize", "per-client", "speedup");
+    for (int i = 0; i < n_counts; i++) {
+        result_t r = run(&board, pipes, counts[i], 0, ticks);
+        printf("%11d %12.2f %12.2f %12.2f %8.1fx\n", counts[i], r.fanout_us, r.serialize_us, r.each_us,
+               r.each_us / r.fanout_us);
+    }
+
+    // Spectator 0 never reads: its pipe fills, then it is skipped and dropped.
+    // Long enough for small deltas to fill a 64 KiB pipe.
+    int stall_ticks = ticks > STALL_TICKS ? ticks : STALL_TICKS;
+    result_t r = run(&board, pipes, MAX_SPECTATORS, 1, stall_ticks);
+    printf("%d spectators, one never reading, %d ticks: fan-out %.2f us/tick, %lu frames skipped, %lu dropped\n",
+           MAX_SPECTATORS, stall_ticks, r.fanout_us, r.skipped, r.dropped);
+
+    for (int i = 0; i < MAX_SPECTATORS; i++) {
+        close(pipes[i][0]);
+        close(pipes[i][1]);
+    }
+    free_board_grid(&board);
+    free(board.pacmans);
+    free(board.ghosts);
+    return 0;
+}
@@ -3,11 +3,11 @@
 #include "debug.h"
 #include <stdlib.h>
 #include <stdio.h> //snprintf
+#include <string.h>
 #include <fcntl.h>
 #include <time.h>
 #include <unistd.h>
 #include <stdarg.h>
-#include <pthread.h>
 
 FILE *debugfile = NULL;
 
@@ -34,6 +34,47 @@ static inline int is_valid_position(board_t* board, int x, int y) {
     return (x >= 0 && x < board->width) && (y >= 0 && y < board->height); // Inside of the board boundaries
 }
 
+// Writes an occupancy char (' ', 'P' or 'M') and keeps the row/column masks in step
+static void set_cell(board_t* board, int x, int y, char content) {
+    int idx = get_board_index(board, x, y);
+    board->cells[idx] = content;
+    uint64_t* row = board->row_occupancy + y * board->row_words;
+    uint64_t* col = board->col_occupancy + x * board->col_words;
+    if (content != ' ' || bit_test(board->walls, idx)) {
+        bit_set(row, x);
+        bit_set(col, y);
+    } else {
+        bit_clear(row, x);
+        bit_clear(col, y);
+    }
+}
+
+// Lowest set bit of set within [from, to], -1 if none
+static int bits_next(const uint64_t* set, int from, int to) {
+    if (from > to) return -1;
+    int w = from >> 6;
+    uint64_t word = set[w] & (~(uint64_t)0 << (from & 63));
+    while (!word) {
+        if (++w > to >> 6) return -1;
+        word = set[w];
+    }
+    int i = (w << 6) + __builtin_ctzll(word);
+    return i <= to ? i : -1;
+}
+
+// Highest set bit of set within [from, to], -1 if none
+static int bits_prev(const uint64_t* set, int from, int to) {
+    if (from > to) return -1;
+    int w = to >> 6;
+    uint64_t word = set[w] & (~(uint64_t)0 >> (63 - (to & 63)));
+    while (!word) {
+        if (--w < from >> 6) return -1;
+        word = set[w];
+    }
+    int i = (w << 6) + 63 - __builtin_clzll(word);
+    return i >= from ? i : -1;
+}
+
 void sleep_ms(int milliseconds) {
     struct timespec ts;
     ts.tv_sec = milliseconds / 1000;
@@ -61,7 +102,7 @@ int move_pacman(board_t* board, int pacman_index, command_t* command) {
 
     if (direction == 'R') {
         char directions[] = {'W', 'S', 'A', 'D'};
-        direction = directions[rand() % 4];
+        direction = directions[board_random(board) % 4];
     }
 
     // Calculate new position based on direction
@@ -98,81 +139,40 @@ int move_pacman(board_t* board, int pacman_index, command_t* command) {
     }
 
     int new_index = get_board_index(board, new_x, new_y);
-    int old_index = get_board_index(board, pac->pos_x, pac->pos_y);
 
-    // locks
-    if (old_index < new_index) {
-        pthread_mutex_lock(&board->board[old_index].lock);
-        pthread_mutex_lock(&board->board[new_index].lock);
-    }
-    else {
-        pthread_mutex_lock(&board->board[new_index].lock);
-        pthread_mutex_lock(&board->board[old_index].lock);
-    }
-
-    char target_content = board->board[new_index].content;
-
-    if (board->board[new_index].has_portal) {
-        board->board[old_index].content = ' ';
-        board->board[new_index].content = 'P';
+    if (bit_test(board->portals, new_index)) {
+        set_cell(board, pac->pos_x, pac->pos_y, ' ');
+        set_cell(board, new_x, new_y, 'P');
+        board->version++;
         return REACHED_PORTAL;
     }
 
     // Check for walls
-    if (target_content == 'W') {
-        goto move_pacman_invalid;
+    if (bit_test(board->walls, new_index)) {
+        return INVALID_MOVE;
     }
 
     // Check for ghosts
-    if (target_content == 'M') {
+    if (board->cells[new_index] == 'M') {
         kill_pacman(board, pacman_index);
-        goto move_pacman_dead;
+        return DEAD_PACMAN;
     }
 
     // Collect points
-    if (board->board[new_index].has_dot) {
+    if (bit_test(board->dots, new_index)) {
         pac->points++;
-        board->board[new_index].has_dot = 0;
+        bit_clear(board->dots, new_index);
+        board->remaining_dots--;
         board->accumulated_points = pac->points;
     }
 
-    board->board[old_index].content = ' ';
+    set_cell(board, pac->pos_x, pac->pos_y, ' ');
     pac->pos_x = new_x;
     pac->pos_y = new_y;
-    board->board[new_index].content = 'P';
+    set_cell(board, new_x, new_y, 'P');
+    board->version++;
 
-    if (old_index < new_index) {
-        pthread_mutex_unlock(&board->board[old_index].lock);
-        pthread_mutex_unlock(&board->board[new_index].lock);
-    }
-    else {
-        pthread_mutex_unlock(&board->board[new_index].lock);
-        pthread_mutex_unlock(&board->board[old_index].lock);
-    }
-    
     return VALID_MOVE;
-
-    move_pacman_invalid:
-    if (old_index < new_index) {
-        pthread_mutex_unlock(&board->board[old_index].lock);
-        pthread_mutex_unlock(&board->board[new_index].lock);
-    }
-    else {
-        pthread_mutex_unlock(&board->board[new_index].lock);
-        pthread_mutex_unlock(&board->board[old_index].lock);
-    }
-    return INVALID_MOVE;
-
-    move_pacman_dead:
-    if (old_index < new_index) {
-        pthread_mutex_unlock(&board->board[old_index].lock);
-        pthread_mutex_unlock(&board->board[new_index].lock);
-    }
-    else {
-        pthread_mutex_unlock(&board->board[new_index].lock);
-        pthread_mutex_unlock(&board->board[old_index].lock);
-    }
-    return DEAD_PACMAN;
 }
 
 int move_ghost_charged(board_t* board, int ghost_index, char direction) {
@@ -181,128 +181,64 @@ int move_ghost_charged(board_t* board, int ghost_index, char direction) {
     int y = ghost->pos_y;
     int new_x = x;
     int new_y = y;
-    int result;
+    int step_x = 0, step_y = 0;
+    int hit; // first occupied cell on the way, -1 if the way is clear
+    int result = VALID_MOVE;
 
     ghost->charged = 0; //uncharge
+    board->version++; // shows as a plain ghost again even if it cannot move
+
+    const uint64_t* row = board->row_occupancy + y * board->row_words;
+    const uint64_t* col = board->col_occupancy + x * board->col_words;
 
     switch (direction) {
         case 'W':
             if (y == 0) return INVALID_MOVE;
-
-            for (int i = 0; i <= y; i++) {
-                pthread_mutex_lock(&board->board[i * board->width + x].lock);
-            }
-
-            new_y = 0; // In case there is no colision
-            for (int i = y - 1; i >= 0; i--) {
-                char target_content = board->board[i * board->width + x].content;
-                if (target_content == 'W' || target_content == 'M') {
-                    new_y = i + 1; // stop before colision
-                    result = VALID_MOVE;
-                    break;
-                }
-                else if (target_content == 'P') {
-                    new_y = i;
-                    result = find_and_kill_pacman(board, new_x, new_y);
-                    break;
-                }
-            }
-
-            for (int i = 0; i <= y; i++) {
-                pthread_mutex_unlock(&board->board[i * board->width + x].lock);
-            }
+            step_y = -1;
+            hit = bits_prev(col, 0, y - 1);
+            new_y = hit < 0 ? 0 : hit; // In case there is no colision
             break;
         case 'S':
             if (y == board->height - 1) return INVALID_MOVE;
-
-            for (int i = y; i < board->height; i++) {
-                pthread_mutex_lock(&board->board[i * board->width + x].lock);
-            }
-
-            new_y = board->height - 1; // In case there is no colision
-            for (int i = y + 1; i < board->height; i++) {
-                char target_content = board->board[i * board->width + x].content;
-                if (target_content == 'W' || target_content == 'M') {
-                    new_y = i - 1; // stop before colision
-                    result = VALID_MOVE;
-                    break;
-                }
-                else if (target_content == 'P') {
-                    new_y = i;
-                    result = find_and_kill_pacman(board, new_x, new_y);
-                    break;
-                }
-            }
-
-            for (int i = y; i < board->height; i++) {
-                pthread_mutex_unlock(&board->board[i * board->width + x].lock);
-            }
+            step_y = 1;
+            hit = bits_next(col, y + 1, board->height - 1);
+            new_y = hit < 0 ? board->height - 1 : hit;
             break;
         case 'A':
             if (x == 0) return INVALID_MOVE;
-
-            for (int j = 0; j <= x; j++) {
-                pthread_mutex_lock(&board->board[y * board->width + j].lock);
-            }
-
-            new_x = 0; // In case there is no colision
-            for (int j = x - 1; j >= 0; j--) {
-                char target_content = board->board[y * board->width + j].content;
-                if (target_content == 'W' || target_content == 'M') {
-                    new_x = j + 1; // stop before colision
-                    result = VALID_MOVE;
-                    break;
-                }
-                else if (target_content == 'P') {
-                    new_x = j;
-                    result = find_and_kill_pacman(board, new_x, new_y);
-                    break;
-                }
-            }
-
-            for (int j = 0; j <= x; j++) {
-                pthread_mutex_unlock(&board->board[y * board->width + j].lock);
-            }
+            step_x = -1;
+            hit = bits_prev(row, 0, x - 1);
+            new_x = hit < 0 ? 0 : hit;
             break;
         case 'D':
             if (x == board->width - 1) return INVALID_MOVE;
-
-            for (int j = x; j < board->width; j++) {
-                pthread_mutex_lock(&board->board[y * board->width + j].lock);
-            }
-
-            new_x = board->width - 1; // In case there is no colision
-            for (int j = x + 1; j < board->width; j++) {
-                char target_content = board->board[y * board->width + j].content;
-                if (target_content == 'W' || target_content == 'M') {
-                    new_x = j - 1; // stop before colision
-                    result = VALID_MOVE;
-                    break;
-                }
-                else if (target_content == 'P') {
-                    new_x = j;
-                    result = find_and_kill_pacman(board, new_x, new_y);
-                    break;
-                }
-            }
-
-            for (int j = x; j < board->width; j++) {
-                pthread_mutex_unlock(&board->board[y * board->width + j].lock);
-            }
+            step_x = 1;
+            hit = bits_next(row, x + 1, board->width - 1);
+            new_x = hit < 0 ? board->width - 1 : hit;
             break;
         default:
             debug("DEFAULT CHARGED MOVE - direction = %c\n", direction);
             return INVALID_MOVE;
     }
 
-    board->board[y * board->width + x].content = ' '; // Or restore the dot if ghost was on one
+    if (hit >= 0) {
+        if (board->cells[get_board_index(board, new_x, new_y)] == 'P') {
+            result = find_and_kill_pacman(board, new_x, new_y);
+        } else {
+            // wall or ghost: stop before colision
+            new_x -= step_x;
+            new_y -= step_y;
+        }
+    }
+
+    set_cell(board, x, y, ' '); // Or restore the dot if ghost was on one
 
     // Update ghost position
     ghost->pos_x = new_x;
     ghost->pos_y = new_y;
 
     // Update board - set new position
-    board->board[new_y * board->width + new_x].content = 'M';
+    set_cell(board, new_x, new_y, 'M');
     return result;
 }
 
@@ -322,7 +258,7 @@ int move_ghost(board_t* board, int ghost_index, command_t* command) {
 
     if (direction == 'R') {
         char directions[] = {'W', 'S', 'A', 'D'};
-        direction = directions[rand() % 4];
+        direction = directions[board_random(board) % 4];
     }
 
     // Calculate new position based on direction
@@ -342,6 +278,7 @@ int move_ghost(board_t* board, int ghost_index, command_t* command) {
         case 'C': // Charge
             ghost->current_move += 1;
             ghost->charged = 1;
+            board->version++;
             return VALID_MOVE;
         case 'T': // Wait
             if (command->turns_left == 1) {
@@ -366,91 +303,134 @@ int move_ghost(board_t* board, int ghost_index, command_t* command) {
 
     // Check board position
     int new_index = new_y * board->width + new_x;
-    int old_index = ghost->pos_y * board->width + ghost->pos_x;
-
-    // locks
-    if (old_index < new_index) {
-        pthread_mutex_lock(&board->board[old_index].lock);
-        pthread_mutex_lock(&board->board[new_index].lock);
-    }
-    else {
-        pthread_mutex_lock(&board->board[new_index].lock);
-        pthread_mutex_lock(&board->board[old_index].lock);
-    }
-
-    char target_content = board->board[new_index].content;
 
     // Check for walls
-    if (target_content == 'W') {
-        goto move_ghost_invalid;
+    if (bit_test(board->walls, new_index)) {
+        return INVALID_MOVE;
     }
 
     // Check for ghosts
-    if (target_content == 'M') {
-        goto move_ghost_invalid;
+    if (board->cells[new_index] == 'M') {
+        return INVALID_MOVE;
     }
 
     int result = VALID_MOVE;
     // Check for pacman
-    if (target_content == 'P') {
-        for (int i = 0; i < board->n_pacmans; i++) {
-            pacman_t* pac = &board->pacmans[i];
-            if (pac->pos_x == new_x && pac->pos_y == new_y && pac->alive) {
-                pac->alive = 0; // Pacman dies
-                kill_pacman(board, i);
-                result = DEAD_PACMAN;
-                break;
-            }
-        }
+    if (board->cells[new_index] == 'P') {
+        result = find_and_kill_pacman(board, new_x, new_y);
     }
 
     // Update board - clear old position (restore what was there)
-    board->board[old_index].content = ' '; // Or restore the dot if ghost was on one
+    set_cell(board, ghost->pos_x, ghost->pos_y, ' '); // Or restore the dot if ghost was on one
     // Update ghost position
     ghost->pos_x = new_x;
     ghost->pos_y = new_y;
     // Update board - set new position
-    board->board[new_index].content = 'M';
+    set_cell(board, new_x, new_y, 'M');
+    board->version++;
 
-    if (old_index < new_index) {
-        pthread_mutex_unlock(&board->board[old_index].lock);
-        pthread_mutex_unlock(&board->board[new_index].lock);
-    }
-    else {
-        pthread_mutex_unlock(&board->board[new_index].lock);
-        pthread_mutex_unlock(&board->board[old_index].lock);
-    }
-    
     return result;
-
-    move_ghost_invalid:
-    if (old_index < new_index) {
-        pthread_mutex_unlock(&board->board[old_index].lock);
-        pthread_mutex_unlock(&board->board[new_index].lock);
-    }
-    else {
-        pthread_mutex_unlock(&board->board[new_index].lock);
-        pthread_mutex_unlock(&board->board[old_index].lock);
-    }
-    return INVALID_MOVE;
 }
 
 void kill_pacman(board_t* board, int pacman_index) {
     debug("Killing %d pacman\n\n", pacman_index);
     pacman_t* pac = &board->pacmans[pacman_index];
-    int index = pac->pos_y * board->width + pac->pos_x;
 
     // Remove pacman from the board
-    board->board[index].content = ' ';
+    set_cell(board, pac->pos_x, pac->pos_y, ' ');
 
     // Mark pacman as dead
     pac->alive = 0;
     board->game_over = 1;
+    board->version++;
+}
+
+void render_board(board_t *board, char *out) {
+    int cells = board->width * board->height;
+    for (int i = 0; i < cells; i++) {
+        if (bit_test(board->walls, i)) {
+            out[i] = '#';
+        } else if (bit_test(board->portals, i)) {
+            out[i] = '@';
+        } else if (bit_test(board->dots, i)) {
+            out[i] = '.';
+        } else {
+            out[i] = ' ';
+        }
+    }
+
+    for (int p = 0; p < board->n_pacmans; p++) {
+        pacman_t *pac = &board->pacmans[p];
+        if (pac->alive && is_valid_position(board, pac->pos_x, pac->pos_y)) {
+            out[get_board_index(board, pac->pos_x, pac->pos_y)] = 'C';
+        }
+    }
+
+    for (int g = 0; g < board->n_ghosts; g++) {
+        ghost_t *ghost = &board->ghosts[g];
+        if (is_valid_position(board, ghost->pos_x, ghost->pos_y)) {
+            out[get_board_index(board, ghost->pos_x, ghost->pos_y)] = ghost->charged ? 'G' : 'M';
+        }
+    }
+}
+
+// Whether an entity with this passo acts this tick: once every 1 + passo
+static int acts(int *idle, int passo) {
+    if (++*idle <= passo) return 0;
+    *idle = 0;
+    return 1;
+}
+
+void tick_board(board_t *board, char pacman_cmd) {
+    if (board->victory || board->game_over) return;
+
+    // 1. Pacman
+    pacman_t *pacman = &board->pacmans[0];
+    if (pacman->alive && acts(&pacman->idle, pacman->passo)) {
+        command_t *play = NULL;
+        command_t c;
+        if (pacman->n_moves == 0) {
+            // Manual control: build a single-move command on the fly
+            if (pacman_cmd != '\0') {
+                c.command = pacman_cmd;
+                c.turns = 1;
+                c.turns_left = 1;
+                play = &c;
+            }
+        } else {
+            play = &pacman->moves[pacman->current_move % pacman->n_moves];
+        }
+
+        if (play) {
+            int result = move_pacman(board, 0, play);
+            if (result == REACHED_PORTAL) {
+                board->victory = 1;
+                return;
+            } else if (result == DEAD_PACMAN) {
+                board->game_over = 1;
+                return;
+            } else if (board->remaining_dots == 0) {
+                board->victory = 1;
+                return;
+            }
+        }
+    }
+
+    // 2. Ghosts, in the order they are listed in the level file
+    for (int g = 0; g < board->n_ghosts; g++) {
+        ghost_t *ghost = &board->ghosts[g];
+        if (ghost->n_moves == 0 || !acts(&ghost->idle, ghost->passo)) continue;
+
+        if (move_ghost(board, g, &ghost->moves[ghost->current_move % ghost->n_moves]) == DEAD_PACMAN) {
+            board->game_over = 1;
+            return;
+        }
+    }
 }
 
 // Static Loading
 int load_pacman(board_t* board) {
-    board->board[1 * board->width + 1].content = 'P'; // Pacman
+    set_cell(board, 1, 1, 'P'); // Pacman
     board->pacmans[0].pos_x = 1;
     board->pacmans[0].pos_y = 1;
     board->pacmans[0].alive = 1;
@@ -460,15 +440,69 @@ int load_pacman(board_t* board) {
 
 // Static Loading
 int load_ghost(board_t* board) {
-    board->board[4 * board->width + 8].content = 'M'; // Monster
+    set_cell(board, 8, 4, 'M'); // Monster
     board->ghosts[0].pos_x = 8;
     board->ghosts[0].pos_y = 4;
-    board->board[0 * board->width + 5].content = 'M'; // Monster
+    set_cell(board, 5, 0, 'M'); // Monster
     board->ghosts[1].pos_x = 5;
     board->ghosts[1].pos_y = 0;
     return 0;
 }
 
+int alloc_board_grid(board_t *board) {
+    int cells = board->width * board->height;
+    int words = BITSET_WORDS(cells);
+
+    board->row_words = BITSET_WORDS(board->width);
+    board->col_words = BITSET_WORDS(board->height);
+    int occupancy_words = board->height * board->row_words + board->width * board->col_words;
+
+    board->cells = malloc(cells);
+    // One block for the three bitsets and the occupancy masks
+    board->walls = calloc(3 * words + occupancy_words, sizeof(uint64_t));
+    if (!board->cells || !board->walls) {
+        free_board_grid(board);
+        return -1;
+    }
+    memset(board->cells, ' ', cells);
+    board->dots = board->walls + words;
+    board->portals = board->walls + 2 * words;
+    board->row_occupancy = board->walls + 3 * words;
+    board->col_occupancy = board->row_occupancy + board->height * board->row_words;
+    return 0;
+}
+
+void seed_board(board_t *board, uint64_t seed) {
+    // One splitmix64 step spreads nearby seeds apart; xorshift must not start at 0
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    board->rng = z ? z : 0x9E3779B97F4A7C15ULL;
+}
+
+void rebuild_occupancy(board_t *board) {
+    memset(board->row_occupancy, 0, board->height * board->row_words * sizeof(uint64_t));
+    memset(board->col_occupancy, 0, board->width * board->col_words * sizeof(uint64_t));
+    for (int y = 0; y < board->height; y++) {
+        for (int x = 0; x < board->width; x++) {
+            int idx = get_board_index(board, x, y);
+            if (board->cells[idx] != ' ' || bit_test(board->walls, idx)) {
+                bit_set(board->row_occupancy + y * board->row_words, x);
+                bit_set(board->col_occupancy + x * board->col_words, y);
+            }
+        }
+    }
+}
+
+void free_board_grid(board_t *board) {
+    free(board->cells);
+    free(board->walls);
+    board->cells = NULL;
+    board->walls = board->dots = board->portals = NULL;
+    board->row_occupancy = board->col_occupancy = NULL;
+}
+
 int load_level(board_t *board, char *filename, char* dirname, int points) {
 
     if (read_level(board, filename, dirname) < 0) {
@@ -487,23 +521,14 @@ int load_level(board_t *board, char *filename, char* dirname, int points) {
     if (read_ghosts(board) < 0) {
         printf("Failed to read ghosts\n");
     }
-
-    pthread_rwlock_init(&board->state_lock, NULL);
-
-    for (int i = 0; i < board->height * board->width; i++) {
-        pthread_mutex_init(&board->board[i].lock, NULL);
-    }
+    rebuild_occupancy(board);
 
     //print_board(board);
     return 0;
 }
 
 void unload_level(board_t * board) {
-    pthread_rwlock_destroy(&board->state_lock);
-    for (int i = 0; i < board->height * board->width; i++) {
-        pthread_mutex_destroy(&board->board[i].lock);
-    }
-    free(board->board);
+    free_board_grid(board);
     free(board->pacmans);
     free(board->ghosts);
 }
@@ -534,7 +559,7 @@ void debug(const char * format, ...) {
 }
 
 void print_board(board_t *board) {
-    if (!board || !board->board) {
+    if (!board || !board->cells) {
         debug("[%d] Board is empty or not initialized.\n", getpid());
         return;
     }
@@ -564,7 +589,7 @@ void print_board(board_t *board) {
         for (int x = 0; x < board->width; x++) {
             int idx = y * board->width + x;
             if (offset < sizeof(buffer) - 2) {
-                buffer[offset++] = board->board[idx].content;
+                buffer[offset++] = bit_test(board->walls, idx) ? 'W' : board->cells[idx];
             }
         }
         if (offset < sizeof(buffer) - 2) {
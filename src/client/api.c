@@ -9,6 +9,10 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <poll.h>
 
 
 struct Session {
@@ -17,24 +21,56 @@ struct Session {
   int notif_pipe;
   char req_pipe_path[MAX_PIPE_PATH_LENGTH + 1];
   char notif_pipe_path[MAX_PIPE_PATH_LENGTH + 1];
+  // Double-buffered frame store: frames[front] is the board last handed out,
+  // the next one is built in the other buffer so that view stays intact
+  // until the call that replaces it returns
+  char *frames[2];
+  int front;
+  int frame_cap;    // bytes in each buffer, grows only when a level needs more
+  int frame_width;  // dimensions of frames[front], 0 before the first frame
+  int frame_height;
+  char *delta;      // delta entries of the frame being read
+  int delta_cap;
+  const shm_frame_t *shm; // frames published by the server, NULL if they come through the pipe
+  int broken;       // a frame could not be read to its end, the rest of the stream is unusable
 };
 
 static struct Session session = {.id = -1};
 
 int pacman_connect(char const *req_pipe_path, char const *notif_pipe_path, char const *server_pipe_path) {
-  if (session.id != -1) return 1; // already connected
-
-  fprintf(stderr, "[client] connecting via %s (req=%s notif=%s)\n", server_pipe_path, req_pipe_path, notif_pipe_path);
+  return pacman_connect_seeded(req_pipe_path, notif_pipe_path, server_pipe_path, 0);
+}
 
-  // Remove existing FIFOs if any
-  unlink(req_pipe_path);
-  unlink(notif_pipe_path);
+int pacman_connect_seeded(char const *req_pipe_path, char const *notif_pipe_path, char const *server_pipe_path,
+                          uint64_t seed) {
+  connect_options_t options = {.seed = seed};
+  return pacman_connect_with(req_pipe_path, notif_pipe_path, server_pipe_path, &options);
+}
 
-  // Create FIFOs
-  if (mkfifo(req_pipe_path, 0666) == -1) { perror("mkfifo req"); return 1; }
-  if (mkfifo(notif_pipe_path, 0666) == -1) { perror("mkfifo notif"); return 1; }
+// Maps the region the server publishes this session's frames in
+static int map_shared_frames(unsigned region) {
+  char name[48];
+  snprintf(name, sizeof(name), SHM_NAME_FORMAT, session.id, region);
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd == -1) {
+    perror("shm_open");
+    return -1;
+  }
+  void *map = mmap(NULL, SHM_REGION_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror("mmap shared frames");
+    return -1;
+  }
+  // Both sides have it mapped now; without a name it cannot outlive them
+  shm_unlink(name);
+  session.shm = map;
+  return 0;
+}
 
-  // Open server pipe for writing (non-blocking retry if server not yet listening)
+// Sends a registration message to the server (non-blocking open, retried
+// while the server is not listening yet). Returns 0 on success, 1 otherwise.
+static int send_registration(char const *server_pipe_path, const char *message, size_t size) {
   int server_fd = -1;
   fprintf(stderr, "[client] opening server pipe (nonblock)...\n");
   for (int attempt = 0; attempt < 100; attempt++) {
@@ -53,47 +89,80 @@ int pacman_connect(char const *req_pipe_path, char const *notif_pipe_path, char
   }
   fprintf(stderr, "[client] server pipe opened\n");
 
+  ssize_t w = write(server_fd, message, size);
+  close(server_fd);
+  if (w == -1) return 1;
+  fprintf(stderr, "[client] sent %zd bytes registration msg\n", w);
+  return 0;
+}
+
+// Opens the notification pipe for reading, before the server hears of it:
+// the server does not wait for this end, and whatever it writes before
+// closing its own (a refusal) would be lost if no reader held the pipe.
+// Returns the fd, -1 on failure.
+static int open_notif_pipe(char const *notif_pipe_path) {
+  // Non-blocking, as a blocking open would wait for the server's end
+  int notif_fd = open(notif_pipe_path, O_RDONLY | O_NONBLOCK);
+  if (notif_fd == -1) {
+    perror("open notif pipe");
+    return -1;
+  }
+  fprintf(stderr, "[client] notif pipe opened\n");
+  return notif_fd;
+}
+
+// Waits for the server's response on notif_fd, then makes it blocking for
+// the frames. Until a writer shows up a read would just see end of file.
+// Returns 0 once there is something to read, -1 on failure.
+static int await_response(int notif_fd) {
+  struct pollfd pfd = {.fd = notif_fd, .events = POLLIN};
+  while (poll(&pfd, 1, -1) == -1) {
+    if (errno != EINTR) {
+      perror("poll notif pipe");
+      return -1;
+    }
+  }
+  return fcntl(notif_fd, F_SETFL, fcntl(notif_fd, F_GETFL) & ~O_NONBLOCK);
+}
+
+int pacman_connect_with(char const *req_pipe_path, char const *notif_pipe_path, char const *server_pipe_path,
+                        const connect_options_t *options) {
+  if (session.id != -1) return 1; // already connected
+
+  fprintf(stderr, "[client] connecting via %s (req=%s notif=%s)\n", server_pipe_path, req_pipe_path, notif_pipe_path);
+
+  // Remove existing FIFOs if any
+  unlink(req_pipe_path);
+  unlink(notif_pipe_path);
+
+  // Create FIFOs
+  if (mkfifo(req_pipe_path, 0666) == -1) { perror("mkfifo req"); return 1; }
+  if (mkfifo(notif_pipe_path, 0666) == -1) { perror("mkfifo notif"); return 1; }
+
   // Prepare message
-  char message[1 + MAX_PIPE_PATH_LENGTH + MAX_PIPE_PATH_LENGTH];
-  message[0] = OP_CODE_CONNECT;
+  char message[CONNECT_EXT_MESSAGE_SIZE];
+  message[0] = OP_CODE_CONNECT_EXT;
   strncpy(message + 1, req_pipe_path, MAX_PIPE_PATH_LENGTH);
   strncpy(message + 1 + MAX_PIPE_PATH_LENGTH, notif_pipe_path, MAX_PIPE_PATH_LENGTH);
   // Null pad
   for (int i = strlen(req_pipe_path); i < MAX_PIPE_PATH_LENGTH; i++) message[1 + i] = '\0';
   for (int i = strlen(notif_pipe_path); i < MAX_PIPE_PATH_LENGTH; i++) message[1 + MAX_PIPE_PATH_LENGTH + i] = '\0';
+  uint32_t flags = options->shared_frames ? CONNECT_FLAG_SHM : 0;
+  memcpy(message + CONNECT_MESSAGE_SIZE, &options->seed, sizeof(options->seed));
+  memcpy(message + CONNECT_MESSAGE_SIZE + sizeof(options->seed), &flags, sizeof(flags));
 
-  // Send request
-  ssize_t w = write(server_fd, message, sizeof(message));
-  if (w == -1) {
-    close(server_fd);
-    return 1;
-  }
-  fprintf(stderr, "[client] sent %zd bytes connect msg\n", w);
-  close(server_fd);
-
-  // Open notification pipe for reading (blocking; will wait for server writer)
-  int notif_fd = -1;
-  for (int attempt = 0; attempt < 100; attempt++) {
-    notif_fd = open(notif_pipe_path, O_RDONLY);
-    if (notif_fd != -1) break;
-    if (errno == ENOENT) {
-      sleep_ms(50);
-      continue;
-    }
-    perror("open notif pipe");
-    return 1;
-  }
-  if (notif_fd == -1) {
-    fprintf(stderr, "[client] failed to open notif pipe after retries\n");
+  int notif_fd = open_notif_pipe(notif_pipe_path);
+  if (notif_fd == -1) return 1;
+  if (send_registration(server_pipe_path, message, sizeof(message)) != 0 || await_response(notif_fd) != 0) {
+    close(notif_fd);
     return 1;
   }
-  fprintf(stderr, "[client] notif pipe opened\n");
 
   // Read response
-  char response[2];
-  ssize_t r = read(notif_fd, response, 2);
+  char response[CONNECT_EXT_RESPONSE_SIZE];
+  ssize_t r = read(notif_fd, response, sizeof(response));
   fprintf(stderr, "[client] read connect resp bytes=%zd code=%d res=%d\n", r, response[0], response[1]);
-  if (r != 2 || response[0] != OP_CODE_CONNECT || response[1] != 0) {
+  if (r != sizeof(response) || response[0] != OP_CODE_CONNECT_EXT || response[1] != 0) {
     close(notif_fd);
     perror("read connect response");
     return 1;
@@ -121,69 +190,247 @@ int pacman_connect(char const *req_pipe_path, char const *notif_pipe_path, char
       session.id = 1;  // Fallback
   }
 
+  // The server may not grant shared memory; then frames come through the pipe
+  unsigned region;
+  memcpy(&region, response + 3, sizeof(region));
+  if ((response[2] & CONNECT_FLAG_SHM) && map_shared_frames(region) != 0) {
+    pacman_disconnect();
+    return 1;
+  }
+  return 0;
+}
+
+int pacman_spectate(char const *notif_pipe_path, char const *server_pipe_path, int session_id) {
+  if (session.id != -1) return 1; // already connected
+
+  fprintf(stderr, "[client] spectating session %d via %s (notif=%s)\n", session_id, server_pipe_path, notif_pipe_path);
+
+  unlink(notif_pipe_path);
+  if (mkfifo(notif_pipe_path, 0666) == -1) { perror("mkfifo notif"); return 1; }
+
+  char message[SPECTATE_MESSAGE_SIZE] = {OP_CODE_SPECTATE};
+  strncpy(message + 1, notif_pipe_path, MAX_PIPE_PATH_LENGTH);
+  int32_t id = session_id;
+  memcpy(message + 1 + MAX_PIPE_PATH_LENGTH, &id, sizeof(id));
+  int notif_fd = open_notif_pipe(notif_pipe_path);
+  if (notif_fd == -1) return 1;
+  if (send_registration(server_pipe_path, message, sizeof(message)) != 0 || await_response(notif_fd) != 0) {
+    close(notif_fd);
+    return 1;
+  }
+
+  char response[SPECTATE_RESPONSE_SIZE];
+  ssize_t r = read(notif_fd, response, sizeof(response));
+  if (r != sizeof(response) || response[0] != OP_CODE_SPECTATE || response[1] != 0) {
+    fprintf(stderr, "[client] spectate refused (bytes=%zd res=%d)\n", r, r == sizeof(response) ? response[1] : -1);
+    close(notif_fd);
+    unlink(notif_pipe_path);
+    return 1;
+  }
+
+  // No request pipe: the session only ever hears a spectator leave
+  session.id = session_id;
+  session.req_pipe = -1;
+  session.notif_pipe = notif_fd;
+  session.req_pipe_path[0] = '\0';
+  strcpy(session.notif_pipe_path, notif_pipe_path);
   return 0;
 }
 
 void pacman_play(char command) {
-  if (session.id == -1) return; // not connected
+  if (session.id == -1 || session.req_pipe == -1) return; // not connected, or spectating
 
-  char message[2];
+  char message[PLAY_MESSAGE_SIZE];
   message[0] = OP_CODE_PLAY;
   message[1] = command;
 
-  write(session.req_pipe, message, 2);
+  write(session.req_pipe, message, sizeof(message));
 }
 
 int pacman_disconnect() {
   if (session.id == -1) return 1; // not connected
 
-  char message[1];
-  message[0] = OP_CODE_DISCONNECT;
-  write(session.req_pipe, message, 1);
-
-  close(session.req_pipe);
+  if (session.req_pipe != -1) {
+    char message[DISCONNECT_MESSAGE_SIZE];
+    message[0] = OP_CODE_DISCONNECT;
+    write(session.req_pipe, message, sizeof(message));
+    close(session.req_pipe);
+    unlink(session.req_pipe_path);
+  }
   close(session.notif_pipe);
-
-  unlink(session.req_pipe_path);
   unlink(session.notif_pipe_path);
 
   session.id = -1;
   session.req_pipe = -1;
   session.notif_pipe = -1;
 
+  free(session.frames[0]);
+  free(session.frames[1]);
+  free(session.delta);
+  session.frames[0] = session.frames[1] = session.delta = NULL;
+  session.frame_cap = session.delta_cap = 0;
+  session.frame_width = 0;
+  session.frame_height = 0;
+  session.broken = 0;
+
+  if (session.shm) munmap((void *)session.shm, SHM_REGION_SIZE);
+  session.shm = NULL;
+
   return 0;
 }
 
+int pacman_shared_frames(void) {
+  return session.shm != NULL;
+}
+
+// Reads exactly size bytes, the pipe may hand a frame over in pieces
+static int read_full(int fd, void *buf, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t r = read(fd, (char *)buf + done, size - done);
+    if (r == -1 && errno == EINTR) continue;
+    if (r <= 0) return -1;
+    done += r;
+  }
+  return 0;
+}
+
+static int get_int(const char *buf, int *offset) {
+  int value;
+  memcpy(&value, buf + *offset, 4);
+  *offset += 4;
+  return value;
+}
+
+// Makes both frame buffers hold at least size bytes, keeping the front one
+static int reserve_frames(int size) {
+  if (size <= session.frame_cap) return 0;
+  for (int i = 0; i < 2; i++) {
+    char *frame = realloc(session.frames[i], size);
+    if (!frame) return -1;
+    session.frames[i] = frame;
+  }
+  session.frame_cap = size;
+  return 0;
+}
+
+// Copies the frame in shm into the back buffer and its header into board.
+// Seqlock read: retried while the server is writing or wrote meanwhile.
+static int read_shared_frame(Board *board) {
+    const shm_frame_t *shm = session.shm;
+    for (;;) {
+      uint32_t seq = atomic_load_explicit(&shm->seq, memory_order_acquire);
+      if (seq & 1) {
+        sched_yield();
+        continue;
+      }
+      int32_t header[7];
+      memcpy(header, shm->header, sizeof(header));
+      long long size = (long long)header[0] * header[1];
+      // A torn header can be anything, only trust it once seq is checked
+      int sane = header[0] >= 0 && header[1] >= 0 && size <= SHM_FRAME_CAP;
+      if (sane) {
+        if (reserve_frames(size) != 0) return -1;
+        memcpy(session.frames[!session.front], shm->cells, size);
+      }
+      atomic_thread_fence(memory_order_acquire);
+      if (atomic_load_explicit(&shm->seq, memory_order_relaxed) != seq) continue;
+      if (!sane) return -1;
+
+      board->width = header[0];
+      board->height = header[1];
+      board->tempo = header[2];
+      board->victory = header[3];
+      board->game_over = header[4];
+      board->accumulated_points = header[5];
+      board->plays = header[6];
+      return 0;
+    }
+}
+
 Board receive_board_update(void) {
     Board board = {0};
     board.data = NULL;
 
-    if (session.id == -1) return board; // not connected
+    if (session.id == -1 || session.broken) return board; // not connected, or the stream is lost
 
-    char header[1 + 4*6]; // OP + 5 ints + points int
-    int bytes_read = read(session.notif_pipe, header, sizeof(header));
-    if (bytes_read != sizeof(header) || header[0] != OP_CODE_BOARD) {
+    char header[BOARD_HEADER_SIZE]; // OP + 5 ints + points int + plays int
+    if (read_full(session.notif_pipe, header, sizeof(header)) != 0 ||
+        (header[0] != OP_CODE_BOARD && header[0] != OP_CODE_BOARD_DELTA && header[0] != OP_CODE_BOARD_SHM)) {
       perror("read notif header");
       return board;
     }
 
     int offset = 1;
-    board.width = *(int*)(header + offset); offset += 4;
-    board.height = *(int*)(header + offset); offset += 4;
-    board.tempo = *(int*)(header + offset); offset += 4;
-    board.victory = *(int*)(header + offset); offset += 4;
-    board.game_over = *(int*)(header + offset); offset += 4;
-    board.accumulated_points = *(int*)(header + offset); offset += 4;
+    board.width = get_int(header, &offset);
+    board.height = get_int(header, &offset);
+    board.tempo = get_int(header, &offset);
+    board.victory = get_int(header, &offset);
+    board.game_over = get_int(header, &offset);
+    board.accumulated_points = get_int(header, &offset);
+    board.plays = get_int(header, &offset);
 
     int data_size = board.width * board.height;
-    board.data = malloc(data_size);
-    if (!board.data) return board;
-
-    if (read(session.notif_pipe, board.data, data_size) != data_size) {
-        free(board.data);
-        board.data = NULL;
+    char *back;
+    if (header[0] == OP_CODE_BOARD_SHM) {
+      // Doorbell: the frame, and the header that matches it, are in shm
+      if (!session.shm || read_shared_frame(&board) != 0) {
+        fprintf(stderr, "[client] doorbell without a readable shared frame\n");
+        return board;
+      }
+      back = session.frames[!session.front];
+    } else if (data_size < 0 || reserve_frames(data_size) != 0) {
+      return board;
+    } else if (header[0] == OP_CODE_BOARD) {
+      back = session.frames[!session.front];
+      if (read_full(session.notif_pipe, back, data_size) != 0) {
+        session.frame_width = session.frame_height = 0;
         return board;
+      }
+    } else {
+      back = session.frames[!session.front];
+      // Delta: patch the cells that changed since the previous frame
+      char count_buf[4];
+      if (read_full(session.notif_pipe, count_buf, 4) != 0) return board;
+      int pos = 0;
+      int count = get_int(count_buf, &pos);
+      if (count < 0 || count > data_size) {
+        // No telling where the entries end, nothing after them can be read
+        fprintf(stderr, "[client] delta frame with %d entries, giving up on the stream\n", count);
+        session.broken = 1;
+        return board;
+      }
+
+      // All entries in one read; the buffer only grows with the largest delta.
+      // They are read even when there is nothing to apply them to, so the
+      // next frame starts where it should.
+      int entries_size = count * DELTA_ENTRY_SIZE;
+      if (entries_size > session.delta_cap) {
+        char *delta = realloc(session.delta, entries_size);
+        if (!delta) {
+          session.broken = 1;
+          return board;
+        }
+        session.delta = delta;
+        session.delta_cap = entries_size;
+      }
+      if (read_full(session.notif_pipe, session.delta, entries_size) != 0) return board;
+      if (board.width != session.frame_width || board.height != session.frame_height) {
+        fprintf(stderr, "[client] delta frame without a matching base frame\n");
+        return board;
+      }
+
+      memcpy(back, session.frames[session.front], data_size);
+      for (int i = 0; i < count; i++) {
+        int entry = i * DELTA_ENTRY_SIZE;
+        int index = get_int(session.delta, &entry);
+        if (index >= 0 && index < data_size) back[index] = session.delta[entry];
+      }
     }
 
+    session.front = !session.front;
+    session.frame_width = board.width;
+    session.frame_height = board.height;
+    board.data = back;
     return board;
-}
\ No newline at end of file
+}
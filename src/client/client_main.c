@@ -2,6 +2,7 @@
 #include "protocol.h"
 #include "display.h"
 #include "debug.h"
+#include "predict.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,6 +17,9 @@ Board board;
 bool stop_execution = false;
 int tempo = 200; // default until first board update arrives
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+bool predict = false; // -p: draw our own moves before the server confirms them
+predictor_t predictor; // guarded by mutex, like the screen
+int watch_id = -1; // -w: session to spectate instead of playing
 
 static void *receiver_thread(void *arg) {
     (void)arg;
@@ -35,14 +39,13 @@ static void *receiver_thread(void *arg) {
 
         pthread_mutex_lock(&mutex);
         tempo = board.tempo;
-        pthread_mutex_unlock(&mutex);
-
-        draw_board_client(board);
-        refresh_screen();
-
-        if (board.data) {
-            free(board.data);
+        if (predict && predict_board(&predictor, board) == 0) {
+            draw_board_client(predict_view(&predictor));
+        } else {
+            draw_board_client(board);
         }
+        refresh_screen();
+        pthread_mutex_unlock(&mutex);
     }
 
     debug("Returning receiver thread...\n");
@@ -50,16 +53,34 @@ static void *receiver_thread(void *arg) {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 3 && argc != 4) {
+    connect_options_t options = {0}; // server picks the seed, frames through the pipe
+    int opt;
+    while ((opt = getopt(argc, argv, "s:pmw:")) != -1) {
+        if (opt == 's') {
+            options.seed = strtoull(optarg, NULL, 10);
+        } else if (opt == 'p') {
+            predict = true;
+        } else if (opt == 'm') {
+            options.shared_frames = 1;
+        } else if (opt == 'w') {
+            watch_id = atoi(optarg);
+        } else {
+            argc = 0; // force usage message
+            break;
+        }
+    }
+    if (argc - optind != 2 && argc - optind != 3) {
         fprintf(stderr,
-            "Usage: %s <client_id> <register_pipe> [commands_file]\n",
+            "Usage: %s [-s seed] [-p] [-m] [-w session_id] <client_id> <register_pipe> [commands_file]\n",
             argv[0]);
         return 1;
     }
 
-    const char *client_id = argv[1];
-    const char *register_pipe = argv[2];
-    const char *commands_file = (argc == 4) ? argv[3] : NULL;
+    if (watch_id >= 0) predict = false; // the pacman on screen is not ours to move
+
+    const char *client_id = argv[optind];
+    const char *register_pipe = argv[optind + 1];
+    const char *commands_file = (argc - optind == 3) ? argv[optind + 2] : NULL;
 
     FILE *cmd_fp = NULL;
     if (commands_file) {
@@ -77,11 +98,14 @@ int main(int argc, char *argv[]) {
              "/tmp/%s_request", client_id);
 
     snprintf(notif_pipe_path, MAX_PIPE_PATH_LENGTH,
-             "/tmp/%s_notification", client_id);
+             watch_id >= 0 ? "/tmp/%s_watch" : "/tmp/%s_notification", client_id);
 
     open_debug_file("client-debug.log");
 
-    if (pacman_connect(req_pipe_path, notif_pipe_path, register_pipe) != 0) {
+    // A spectator only draws; its keys other than Q are ignored
+    int connected = watch_id >= 0 ? pacman_spectate(notif_pipe_path, register_pipe, watch_id)
+                                  : pacman_connect_with(req_pipe_path, notif_pipe_path, register_pipe, &options);
+    if (connected != 0) {
         perror("Failed to connect to server");
         return 1;
     }
@@ -107,7 +131,7 @@ int main(int argc, char *argv[]) {
         }
         pthread_mutex_unlock(&mutex);
 
-        if (cmd_fp) {
+        if (cmd_fp && watch_id < 0) {
             // Input from file
             ch = fgetc(cmd_fp);
 
@@ -159,6 +183,17 @@ int main(int argc, char *argv[]) {
 
         pacman_play(command);
 
+        // Show the move now, the server's next board confirms or corrects it
+        if (predict) {
+            pthread_mutex_lock(&mutex);
+            predict_play(&predictor, command);
+            if (predictor.shown) {
+                draw_board_client(predict_view(&predictor));
+                refresh_screen();
+            }
+            pthread_mutex_unlock(&mutex);
+        }
+
         // Throttle to server tick to avoid flooding the pipe and freezing the UI
         pthread_mutex_lock(&mutex);
         int wait_for = tempo;
@@ -180,6 +215,7 @@ int main(int argc, char *argv[]) {
         fclose(cmd_fp);
 
     pthread_mutex_destroy(&mutex);
+    predict_free(&predictor);
 
     terminal_cleanup();
 
@@ -3,6 +3,7 @@
 #include "api.h"
 #include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
 
 
 int terminal_init() {
@@ -47,240 +48,103 @@ int terminal_init() {
 }
 
 
-void draw_board_client(Board board) {
-    // Clear the screen before redrawing
-    clear();
-
-    // Draw the border/title
-    attron(COLOR_PAIR(5));
-    mvprintw(0, 0, "=== PACMAN GAME ===");
-    if (board.game_over) {
-        mvprintw(1, 0, " GAME OVER ");
-    } else if (board.victory) {
-        mvprintw(1, 0, " VICTORY ");
-    } else {
-        mvprintw(1, 0, " Use W/A/S/D to move | Q to quit");
+// What is on the screen, so a frame only redraws what changed
+static char *drawn;       // cells as last drawn, width*height
+static int drawn_cap;
+static int drawn_width, drawn_height; // 0 until the first frame
+static int drawn_status = -1;         // 0 playing, 1 game over, 2 victory
+static int drawn_points;
+
+// Colour and glyph a board cell is drawn with
+static chtype cell_attr(char ch, char *glyph) {
+    *glyph = ch;
+    switch (ch) {
+        case '#': return COLOR_PAIR(3);         // Wall
+        case 'C': return COLOR_PAIR(1) | A_BOLD; // Pacman
+        case 'M': return COLOR_PAIR(2) | A_BOLD; // Monster/Ghost
+        case 'G':                                // Charged Monster/Ghost
+            *glyph = 'M';
+            return COLOR_PAIR(2) | A_BOLD | A_DIM;
+        case '.': return COLOR_PAIR(4);          // Dot
+        case '@': return COLOR_PAIR(6);          // Portal
+        default: return A_NORMAL;
     }
-    attroff(COLOR_PAIR(5));
+}
 
+void draw_board_client(Board board) {
     // Starting row for the game board (leave space for UI)
     int start_row = 3;
-
-    // Draw the board
-    for (int y = 0; y < board.height; y++) {
-        for (int x = 0; x < board.width; x++) {
-            char ch = board.data[y * board.width + x];
-
-            // Move cursor to position
-            move(start_row + y, x);
-
-            // Draw with appropriate color
-            switch (ch) {
-                case '#': // Wall
-                    attron(COLOR_PAIR(3));
-                    addch('#');
-                    attroff(COLOR_PAIR(3));
-                    break;
-
-                case 'C': // Pacman
-                    attron(COLOR_PAIR(1) | A_BOLD);
-                    addch('C');
-                    attroff(COLOR_PAIR(1) | A_BOLD);
-                    break;
-
-                case 'M': // Monster/Ghost
-                    attron(COLOR_PAIR(2) | A_BOLD);
-                    addch('M');
-                    attroff(COLOR_PAIR(2) | A_BOLD);  
-                    break;
-
-                case 'G': // Charged Monster/Ghost
-                    attron((COLOR_PAIR(2) | A_BOLD) | A_DIM);
-                    addch('M');
-                    attroff((COLOR_PAIR(2) | A_BOLD) | A_DIM);  
-                    break;
-
-                case '.': // Dot
-                    attron(COLOR_PAIR(4));
-                    addch('.');
-                    attroff(COLOR_PAIR(4));
-                    break;
-
-                case '@': // Portal
-                    attron(COLOR_PAIR(6));
-                    addch('@');
-                    attroff(COLOR_PAIR(6));
-                    break;
-
-                case ' ': // Empty space
-                    addch(' ');
-                    break;
-
-                default:
-                    addch(ch);
-                    break;
-            }
+    int size = board.width * board.height;
+
+    // New dimensions: wipe the old board and draw everything again. erase()
+    // only touches the virtual screen, so unchanged characters still cost
+    // nothing on the terminal
+    if (board.width != drawn_width || board.height != drawn_height) {
+        if (size > drawn_cap) {
+            char *bigger = realloc(drawn, size);
+            if (!bigger) return;
+            drawn = bigger;
+            drawn_cap = size;
         }
+        memset(drawn, 0, size); // no cell looks like this, all get drawn
+        drawn_width = board.width;
+        drawn_height = board.height;
+        drawn_status = -1;
+        drawn_points = -1;
+        erase();
+
+        // Draw the border/title
+        attrset(COLOR_PAIR(5));
+        mvprintw(0, 0, "=== PACMAN GAME ===");
     }
 
-    // Draw score/status at the bottom
-    attron(COLOR_PAIR(5));
-    mvprintw(start_row + board.height + 1, 0, "Points: %d",
-             board.accumulated_points);
-    attroff(COLOR_PAIR(5));
-}
-
-// Does exaclty the same as draw board but stores the output in a string instead of printing it
-char* get_board_displayed(board_t* board) {
-    size_t buffer_size = (board->width  * board->height) + 1;
-    char* output = malloc(buffer_size);
-    size_t pos = 0;
-    for (int y = 0; y < board->height; y++) {
-        for (int x = 0; x < board->width; x++) {
-            int index = y * board->width + x;
-            char ch = board->board[index].content;
-            int ghost_charged = 0;
-
-            for (int g = 0; g < board->n_ghosts; g++) {
-                ghost_t* ghost = &board->ghosts[g];
-                if (ghost->pos_x == x && ghost->pos_y == y) {
-                    if (ghost->charged)
-                        ghost_charged = 1;
-                    break;
-                }
-            }
-
-            // Draw with appropriate character
-            switch (ch) {
-                case 'W': // Wall
-                    output[pos++] = '#';
-                    break;
-
-                case 'P': // Pacman
-                    output[pos++] = 'C';
-                    break;
-
-                case 'M': // Monster/Ghost
-                    if (ghost_charged) {
-                        output[pos++] = 'G'; 
-                    } else {
-                        output[pos++] = 'M';
-                    }
-                    break;
-
-                case ' ': // Empty space
-                    if (board->board[index].has_portal) {
-                        output[pos++] = '@';
-                    }
-                    else if (board->board[index].has_dot) {
-                        output[pos++] = '.';
-                    }
-                    else
-                        output[pos++] = ' ';
-                    break;
-
-                default:
-                    output[pos++] = ch;
-                    break;
-            }
+    int status = board.game_over ? 1 : board.victory ? 2 : 0;
+    if (status != drawn_status) {
+        attrset(COLOR_PAIR(5));
+        if (status == 1) {
+            mvprintw(1, 0, " GAME OVER ");
+        } else if (status == 2) {
+            mvprintw(1, 0, " VICTORY ");
+        } else {
+            mvprintw(1, 0, " Use W/A/S/D to move | Q to quit");
         }
+        clrtoeol();
+        drawn_status = status;
     }
-    
-    output[pos] = '\0';
-    return output;
-}
-
-void draw_board(board_t* board, int mode) {
-    // Clear the screen before redrawing
-    clear();
-
-    // Draw the border/title
-    attron(COLOR_PAIR(5));
-    mvprintw(0, 0, "=== PACMAN GAME ===");
-    switch(mode) {
-    case DRAW_GAME_OVER:
-        mvprintw(1, 0, " GAME OVER ");
-        break;
-
-    case DRAW_WIN:
-        mvprintw(1, 0, " VICTORY ");
-        break;
-
-    case DRAW_MENU:
-        mvprintw(1, 0, "Level: %s | Use W/A/S/D to move | Q to quit | G to quicksave ", board->level_name);
-        break;
-    }
-
-
-    // Starting row for the game board (leave space for UI)
-    int start_row = 3;
-
-    // Draw the board
-    for (int y = 0; y < board->height; y++) {
-        for (int x = 0; x < board->width; x++) {
-            int index = y * board->width + x;
-            char ch = board->board[index].content;
-            int ghost_charged = 0;
-
-            for (int g = 0; g < board->n_ghosts; g++) {
-                ghost_t* ghost = &board->ghosts[g];
-                if (ghost->pos_x == x && ghost->pos_y == y) {
-                    if (ghost->charged)
-                        ghost_charged = 1;
-                    break;
-                }
-            }
-
-            // Move cursor to position
-            move(start_row + y, x);
 
-            // Draw with appropriate color
-            switch (ch) {
-                case 'W': // Wall
-                    attron(COLOR_PAIR(3));
-                    addch('#');
-                    attroff(COLOR_PAIR(3));
-                    break;
-
-                case 'P': // Pacman
-                    attron(COLOR_PAIR(1) | A_BOLD);
-                    addch('C');
-                    attroff(COLOR_PAIR(1) | A_BOLD);
-                    break;
-
-                case 'M': // Monster/Ghost
-                    attron((COLOR_PAIR(2) | A_BOLD) | ((ghost_charged) ? (A_DIM) : (0)));
-                    addch('M');
-                    attroff((COLOR_PAIR(2) | A_BOLD) | ((ghost_charged) ? (A_DIM) : (0)));
-                    break;
-
-                case ' ': // Empty space
-                    if (board->board[index].has_portal) {
-                        attron(COLOR_PAIR(6));
-                        addch('@');
-                        attroff(COLOR_PAIR(6));
-                    }
-                    else if (board->board[index].has_dot) {
-                        attron(COLOR_PAIR(4));
-                        addch('.');
-                        attroff(COLOR_PAIR(4));
-                    }
-                    else
-                        addch(' ');
-                    break;
-
-                default:
-                    addch(ch);
-                    break;
+    // Changed cells of a row go out in runs that share one attribute
+    char run[board.width > 0 ? board.width : 1];
+    for (int y = 0; y < board.height; y++) {
+        const char *row = board.data + y * board.width;
+        char *old = drawn + y * board.width;
+        int x = 0;
+        while (x < board.width) {
+            if (row[x] == old[x]) {
+                x++;
+                continue;
             }
+            int run_x = x, len = 0;
+            char glyph;
+            chtype attr = cell_attr(row[x], &glyph);
+            do {
+                run[len++] = glyph;
+                old[x] = row[x];
+                x++;
+            } while (x < board.width && row[x] != old[x] && cell_attr(row[x], &glyph) == attr);
+
+            attrset(attr);
+            mvaddnstr(start_row + y, run_x, run, len);
         }
     }
 
     // Draw score/status at the bottom
-    attron(COLOR_PAIR(5));
-    mvprintw(start_row + board->height + 1, 0, "Points: %d",
-             board->pacmans[0].points); // Assuming first pacman for now
-    attroff(COLOR_PAIR(5));
+    if (board.accumulated_points != drawn_points) {
+        attrset(COLOR_PAIR(5));
+        mvprintw(start_row + board.height + 1, 0, "Points: %d", board.accumulated_points);
+        clrtoeol();
+        drawn_points = board.accumulated_points;
+    }
+    attrset(A_NORMAL);
 }
 
 void draw(char c, int colour_i, int pos_x, int pos_y) {
@@ -291,8 +155,10 @@ void draw(char c, int colour_i, int pos_x, int pos_y) {
 }
 
 void refresh_screen() {
-    // Update the physical screen with the virtual screen
-    refresh();
+    // Update the physical screen with the virtual screen; curses sends only
+    // the characters that differ from what the terminal already shows
+    wnoutrefresh(stdscr);
+    doupdate();
 }
 
 char get_input() {
@@ -0,0 +1,68 @@
+#include "predict.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Moves the pacman in cells one step, if the step cannot trigger a game rule
+static void apply_move(char *cells, int width, int height, char command) {
+    int dx = 0, dy = 0;
+    switch (command) {
+        case 'W': dy = -1; break;
+        case 'S': dy = 1; break;
+        case 'A': dx = -1; break;
+        case 'D': dx = 1; break;
+        default: return;
+    }
+
+    char *pacman = memchr(cells, 'C', width * height);
+    if (!pacman) return;
+    int index = pacman - cells;
+    int x = index % width + dx, y = index / width + dy;
+    if (x < 0 || x >= width || y < 0 || y >= height) return;
+
+    // Walls block, ghosts and portals are for the server to resolve
+    char *target = &cells[y * width + x];
+    if (*target != ' ' && *target != '.') return;
+    *target = 'C';
+    *pacman = ' ';
+}
+
+int predict_board(predictor_t *p, Board board) {
+    int size = board.width * board.height;
+    if (size > p->cap) {
+        char *shown = realloc(p->shown, size);
+        if (!shown) return -1;
+        p->shown = shown;
+        p->cap = size;
+    }
+    memcpy(p->shown, board.data, size);
+    board.data = p->shown;
+    p->board = board;
+
+    if (board.plays > p->plays_acked) p->plays_acked = board.plays;
+    if (p->plays_acked > p->plays_sent) p->plays_acked = p->plays_sent;
+    if (board.game_over || board.victory) return 0;
+
+    // Plays the server has not taken yet happen again on its board
+    int first = p->plays_sent - PREDICT_MAX_PENDING;
+    if (first < p->plays_acked) first = p->plays_acked;
+    for (int n = first; n < p->plays_sent; n++) {
+        apply_move(p->shown, board.width, board.height, p->pending[n % PREDICT_MAX_PENDING]);
+    }
+    return 0;
+}
+
+void predict_play(predictor_t *p, char command) {
+    p->pending[p->plays_sent++ % PREDICT_MAX_PENDING] = command;
+    if (p->shown && !p->board.game_over && !p->board.victory) {
+        apply_move(p->shown, p->board.width, p->board.height, command);
+    }
+}
+
+Board predict_view(const predictor_t *p) {
+    return p->board;
+}
+
+void predict_free(predictor_t *p) {
+    free(p->shown);
+    memset(p, 0, sizeof(*p));
+}
@@ -133,59 +133,10 @@ void draw_board_client(Board board) {
 char* get_board_displayed(board_t* board) {
     size_t buffer_size = (board->width  * board->height) + 1;
     char* output = malloc(buffer_size);
-    size_t pos = 0;
-    for (int y = 0; y < board->height; y++) {
-        for (int x = 0; x < board->width; x++) {
-            int index = y * board->width + x;
-            char ch = board->board[index].content;
-            int ghost_charged = 0;
-
-            for (int g = 0; g < board->n_ghosts; g++) {
-                ghost_t* ghost = &board->ghosts[g];
-                if (ghost->pos_x == x && ghost->pos_y == y) {
-                    if (ghost->charged)
-                        ghost_charged = 1;
-                    break;
-                }
-            }
+    if (!output) return NULL;
 
-            // Draw with appropriate character
-            switch (ch) {
-                case 'W': // Wall
-                    output[pos++] = '#';
-                    break;
-
-                case 'P': // Pacman
-                    output[pos++] = 'C';
-                    break;
-
-                case 'M': // Monster/Ghost
-                    if (ghost_charged) {
-                        output[pos++] = 'G'; 
-                    } else {
-                        output[pos++] = 'M';
-                    }
-                    break;
-
-                case ' ': // Empty space
-                    if (board->board[index].has_portal) {
-                        output[pos++] = '@';
-                    }
-                    else if (board->board[index].has_dot) {
-                        output[pos++] = '.';
-                    }
-                    else
-                        output[pos++] = ' ';
-                    break;
-
-                default:
-                    output[pos++] = ch;
-                    break;
-            }
-        }
-    }
-    
-    output[pos] = '\0';
+    render_board(board, output);
+    output[buffer_size - 1] = '\0';
     return output;
 }
 
@@ -214,58 +165,53 @@ void draw_board(board_t* board, int mode) {
     // Starting row for the game board (leave space for UI)
     int start_row = 3;
 
+    char* cells = get_board_displayed(board);
+    if (!cells) return;
+
     // Draw the board
     for (int y = 0; y < board->height; y++) {
         for (int x = 0; x < board->width; x++) {
-            int index = y * board->width + x;
-            char ch = board->board[index].content;
-            int ghost_charged = 0;
-
-            for (int g = 0; g < board->n_ghosts; g++) {
-                ghost_t* ghost = &board->ghosts[g];
-                if (ghost->pos_x == x && ghost->pos_y == y) {
-                    if (ghost->charged)
-                        ghost_charged = 1;
-                    break;
-                }
-            }
+            char ch = cells[y * board->width + x];
 
             // Move cursor to position
             move(start_row + y, x);
 
             // Draw with appropriate color
             switch (ch) {
-                case 'W': // Wall
+                case '#': // Wall
                     attron(COLOR_PAIR(3));
                     addch('#');
                     attroff(COLOR_PAIR(3));
                     break;
 
-                case 'P': // Pacman
+                case 'C': // Pacman
                     attron(COLOR_PAIR(1) | A_BOLD);
                     addch('C');
                     attroff(COLOR_PAIR(1) | A_BOLD);
                     break;
 
                 case 'M': // Monster/Ghost
-                    attron((COLOR_PAIR(2) | A_BOLD) | ((ghost_charged) ? (A_DIM) : (0)));
+                    attron(COLOR_PAIR(2) | A_BOLD);
                     addch('M');
-                    attroff((COLOR_PAIR(2) | A_BOLD) | ((ghost_charged) ? (A_DIM) : (0)));
+                    attroff(COLOR_PAIR(2) | A_BOLD);
                     break;
 
-                case ' ': // Empty space
-                    if (board->board[index].has_portal) {
-                        attron(COLOR_PAIR(6));
-                        addch('@');
-                        attroff(COLOR_PAIR(6));
-                    }
-                    else if (board->board[index].has_dot) {
-                        attron(COLOR_PAIR(4));
-                        addch('.');
-                        attroff(COLOR_PAIR(4));
-                    }
-                    else
-                        addch(' ');
+                case 'G': // Charged Monster/Ghost
+                    attron((COLOR_PAIR(2) | A_BOLD) | A_DIM);
+                    addch('M');
+                    attroff((COLOR_PAIR(2) | A_BOLD) | A_DIM);
+                    break;
+
+                case '.': // Dot
+                    attron(COLOR_PAIR(4));
+                    addch('.');
+                    attroff(COLOR_PAIR(4));
+                    break;
+
+                case '@': // Portal
+                    attron(COLOR_PAIR(6));
+                    addch('@');
+                    attroff(COLOR_PAIR(6));
                     break;
 
                 default:
@@ -274,6 +220,7 @@ void draw_board(board_t* board, int mode) {
             }
         }
     }
+    free(cells);
 
     // Draw score/status at the bottom
     attron(COLOR_PAIR(5));
@@ -0,0 +1,293 @@
+#include "frame.h"
+#include "protocol.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void put_int(char *msg, int *offset, int value) {
+    memcpy(msg + *offset, &value, 4);
+    *offset += 4;
+}
+
+static int reserve(frame_state_t *fs, int size) {
+    if (fs->msg_cap >= size) return 0;
+    char *msg = realloc(fs->msg, size);
+    if (!msg) return -1;
+    fs->msg = msg;
+    fs->msg_cap = size;
+    return 0;
+}
+
+// Whether the client's latest frame already shows this board
+static int client_has(const frame_state_t *fs, const board_t *board) {
+    if (fs->version != board->version || fs->plays_sent != fs->plays) return 0;
+    if (fs->shm_synced) return fs->shm->header[0] == board->width && fs->shm->header[1] == board->height;
+    return fs->synced && fs->width == board->width && fs->height == board->height;
+}
+
+static void fill_header(const frame_state_t *fs, const board_t *board, int32_t header[7]) {
+    header[0] = board->width;
+    header[1] = board->height;
+    header[2] = board->tempo;
+    header[3] = board->victory;
+    header[4] = board->game_over;
+    header[5] = board->accumulated_points;
+    header[6] = fs->plays;
+}
+
+// Writes the frame into the shared region and rings the doorbell
+static int publish_shm(frame_state_t *fs, int notif_fd, board_t *board, const int32_t header[7]) {
+    shm_frame_t *shm = fs->shm;
+    uint32_t seq = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+    atomic_store_explicit(&shm->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(shm->header, header, sizeof(shm->header));
+    render_board(board, shm->cells);
+    atomic_store_explicit(&shm->seq, seq + 2, memory_order_release);
+
+    // The doorbell repeats the header so both transports read alike; the
+    // client uses the copy in the region, which matches its cells
+    char msg[BOARD_HEADER_SIZE];
+    msg[0] = OP_CODE_BOARD_SHM;
+    memcpy(msg + 1, header, BOARD_HEADER_SIZE - 1);
+    // Short enough to go in whole or not at all; a missed one rings next tick
+    if (write(notif_fd, msg, sizeof(msg)) != sizeof(msg)) {
+        int saved = errno;
+        if (saved != EAGAIN) perror("write notif doorbell");
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+// Writes what the pipe takes of the pending message. Returns 0 once it is all
+// in, -1 otherwise: errno EAGAIN if the pipe is still full, the write's error
+// if it failed.
+static int flush_pending(frame_state_t *fs, int notif_fd) {
+    while (fs->pending_len > 0) {
+        ssize_t w = write(notif_fd, fs->msg + fs->pending_off, fs->pending_len);
+        if (w == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        fs->pending_off += w;
+        fs->pending_len -= w;
+        fs->missed = 0; // the client is reading, however slowly
+    }
+    return 0;
+}
+
+// Counts a tick in which the client took nothing
+static int missed(frame_state_t *fs) {
+    fs->missed++;
+    errno = EAGAIN;
+    return -1;
+}
+
+// Whether a frame is due: the client lacks this board or the keepalive ran out
+static int frame_due(const frame_state_t *fs, const board_t *board, long long now) {
+    return !client_has(fs, board) || (fs->keepalive_ms > 0 && now - fs->sent_ms >= fs->keepalive_ms);
+}
+
+int frame_serialize(frame_state_t *fs, board_t *board, int full, const char **msg_out) {
+    int data_size = board->width * board->height;
+    long long now = now_ms();
+    if (!full && !frame_due(fs, board, now)) return 0;
+
+    // New dimensions: drop the previous frame, a full one has to be sent
+    if (fs->width != board->width || fs->height != board->height) {
+        frame_free(fs);
+        fs->last = malloc(data_size);
+        fs->current = malloc(data_size);
+        if (!fs->last || !fs->current) {
+            frame_free(fs);
+            return -1;
+        }
+        fs->width = board->width;
+        fs->height = board->height;
+    }
+
+    // Display-ready chars so the client can show dots/portals
+    render_board(board, fs->current);
+
+    int keyframe = full || !fs->synced;
+    int changes = 0;
+    if (!keyframe) {
+        for (int i = 0; i < data_size; i++) {
+            if (fs->current[i] != fs->last[i]) changes++;
+        }
+        // A delta bigger than the grid itself is not worth it
+        keyframe = 4 + changes * DELTA_ENTRY_SIZE >= data_size;
+    }
+
+    int msg_size = keyframe ? BOARD_HEADER_SIZE + data_size
+                            : BOARD_HEADER_SIZE + 4 + changes * DELTA_ENTRY_SIZE;
+    if (reserve(fs, msg_size) != 0) return -1;
+    char *msg = fs->msg;
+
+    int32_t header[7];
+    fill_header(fs, board, header);
+    msg[0] = keyframe ? OP_CODE_BOARD : OP_CODE_BOARD_DELTA;
+    int offset = 1;
+    for (int i = 0; i < 7; i++) put_int(msg, &offset, header[i]);
+
+    if (keyframe) {
+        memcpy(msg + offset, fs->current, data_size);
+    } else {
+        put_int(msg, &offset, changes);
+        for (int i = 0; i < data_size; i++) {
+            if (fs->current[i] != fs->last[i]) {
+                put_int(msg, &offset, i);
+                msg[offset++] = fs->current[i];
+            }
+        }
+    }
+
+    // From here on the frame counts as sent; a failed write calls frame_reset
+    char *tmp = fs->last;
+    fs->last = fs->current;
+    fs->current = tmp;
+    fs->synced = 1;
+    fs->shm_synced = 0;
+    fs->version = board->version;
+    fs->plays_sent = fs->plays;
+    fs->sent_ms = now;
+    *msg_out = msg;
+    return msg_size;
+}
+
+int send_board_update(frame_state_t *fs, int notif_fd, board_t *board) {
+    int data_size = board->width * board->height;
+    long long now = now_ms();
+
+    // The rest of a frame the pipe could not take goes first, nothing may
+    // come between its bytes
+    if (flush_pending(fs, notif_fd) != 0) {
+        if (errno != EAGAIN) {
+            perror("write notif board");
+            return -1;
+        }
+        return missed(fs);
+    }
+
+    // Nothing moved since the last frame: no need to serialize or write
+    if (!frame_due(fs, board, now)) return 0;
+
+    if (fs->shm && data_size <= SHM_FRAME_CAP) {
+        int32_t header[7];
+        fill_header(fs, board, header);
+        if (publish_shm(fs, notif_fd, board, header) != 0) {
+            return errno == EAGAIN ? missed(fs) : -1;
+        }
+        fs->missed = 0;
+        fs->shm_synced = 1;
+        fs->synced = 0; // the pipe's delta base is stale now
+        fs->version = board->version;
+        fs->plays_sent = fs->plays;
+        fs->sent_ms = now;
+        return 0;
+    }
+
+    const char *msg;
+    int msg_size = frame_serialize(fs, board, 0, &msg);
+    if (msg_size <= 0) return msg_size;
+
+    // What the pipe does not take now is written on the next calls
+    fs->pending_off = 0;
+    fs->pending_len = msg_size;
+    if (flush_pending(fs, notif_fd) == 0) return 0;
+    int saved = errno;
+    if (fs->pending_off == 0) {
+        // Not a byte got in: skip the frame, the next one goes in full since
+        // this one may have been the base of a delta
+        fs->pending_len = 0;
+        frame_reset(fs);
+        if (saved == EAGAIN) return missed(fs);
+    }
+    if (saved == EAGAIN) return 0; // the rest follows
+    perror("write notif board");
+    errno = saved;
+    return -1;
+}
+
+int notif_open(const char *path, int *hold) {
+    // A FIFO opened read-write never waits for a peer (as the registration
+    // FIFO is opened), and with it as the reader the writer opens at once
+    *hold = open(path, O_RDWR | O_NONBLOCK);
+    if (*hold == -1) return -1;
+    int fd = open(path, O_WRONLY | O_NONBLOCK);
+    if (fd == -1) {
+        close(*hold);
+        *hold = -1;
+    }
+    return fd;
+}
+
+void notif_release_hold(int fd, int *hold) {
+    if (*hold == -1) return;
+    int queued;
+    if (ioctl(fd, FIONREAD, &queued) == 0 && queued == 0) {
+        close(*hold);
+        *hold = -1;
+    }
+}
+
+void frame_reset(frame_state_t *fs) {
+    fs->synced = 0;
+    fs->shm_synced = 0;
+}
+
+void frame_free(frame_state_t *fs) {
+    free(fs->last);
+    free(fs->current);
+    free(fs->msg);
+    fs->last = fs->current = fs->msg = NULL;
+    fs->msg_cap = 0;
+    fs->pending_len = 0;
+    fs->width = fs->height = 0;
+    fs->synced = 0;
+}
+
+int frame_shm_open(frame_state_t *fs, int session_id, unsigned region) {
+    snprintf(fs->shm_name, sizeof(fs->shm_name), SHM_NAME_FORMAT, session_id, region);
+    int fd = shm_open(fs->shm_name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd == -1) {
+        perror("shm_open");
+        return -1;
+    }
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, SHM_REGION_SIZE) == 0) {
+        map = mmap(NULL, SHM_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("shm map");
+        shm_unlink(fs->shm_name);
+        return -1;
+    }
+
+    fs->shm = map; // ftruncate zeroed it, seq starts even
+    fs->shm->cap = SHM_FRAME_CAP;
+    fs->shm_synced = 0;
+    return 0;
+}
+
+void frame_shm_close(frame_state_t *fs) {
+    if (!fs->shm) return;
+    munmap(fs->shm, SHM_REGION_SIZE);
+    shm_unlink(fs->shm_name); // usually gone already, the client unlinks it once mapped
+    fs->shm = NULL;
+    fs->shm_synced = 0;
+}
@@ -2,6 +2,11 @@
 #include "display.h"
 #include "debug.h"
 #include "protocol.h"
+#include "scheduler.h"
+#include "frame.h"
+#include "levels.h"
+#include "input.h"
+#include "spectate.h"
 #include <stdlib.h>
 #include <fcntl.h>
 #include <string.h>
@@ -10,58 +15,65 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <sys/types.h>
-#include <dirent.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <pthread.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
 #include <errno.h>
 #include <signal.h>
-#include <semaphore.h>
+#include <stdatomic.h>
 
-#define MAX_CLIENTS 25
-#define BUFFER_SIZE 25
+#define DEFAULT_KEEPALIVE_MS 1000 // idle sessions still send a frame this often
+#define DEFAULT_INPUT_DEPTH 16 // plays a session can hold before the overflow policy applies
+#define INPUTS_PER_TICK 1 // plays consumed per tick, each one moves pacman once
+#define REQUEST_READ_SIZE 4096 // request bytes read per syscall, a whole burst of plays at once
+#define MAX_HELD_CONNECTS 16 // connect requests read while the server is full, waiting for a slot
 
 typedef struct{
     int client_id;
     int points;
 } client_info_t;
 
-typedef struct {
-    board_t *board;
-    int session_id;
-    int stop;
-    pthread_mutex_t cmd_lock;
-    char pending_cmd;
-} session_runtime_t;
-
-static void* pacman_thread(void *arg);
-static void* ghost_thread(void *arg);
-
-typedef struct {
-    session_runtime_t *runtime;
-    int ghost_index;
-} ghost_thread_arg_t;
-
-typedef struct {
+typedef struct session_ctx {
     int req_fd;
+    int req_hold; // writer on the request FIFO until the client's first bytes, -1 after
     int notif_fd;
-    char levels_dir[256];
+    int notif_hold; // see notif_open, -1 once released
     int session_id;
     char req_pipe[41];
     char notif_pipe[41];
+    level_catalog_t *catalog; // levels as they were when the session started
+    int level_idx; // cursor into catalog, level currently being played
+    int level_loaded;
+    int carry_points;
+    atomic_int points; // accumulated points, set by the ticks when they change, read by the host for scores.log
+    uint64_t seed; // of board.rng, logged so the session can be replayed
+    board_t board; // board.rng carries over from level to level
+    frame_state_t frames; // what the client last received, for delta frames
+    task_t task; // scheduler handle, runs session_step
+    input_queue_t input; // plays from the host thread, consumed by the ticks
+    atomic_int disconnected; // client sent OP_CODE_DISCONNECT or closed its pipe
+    char partial[MAX_REQUEST_SIZE]; // start of a request the last read cut short
+    int partial_len;
+    spectators_t spectators; // OP_CODE_SPECTATE clients watching this session
+    struct session_ctx *next_closed;
+    struct session_ctx *next_live;
 } session_ctx_t;
 
 typedef struct {
     char fifo_registo[256];
     char levels_dir[256];
     int max_games;
+    int keepalive_ms; // see frame_state_t
+    int input_depth; // see input_queue_t
+    input_policy_t input_policy;
 } host_ctx_t;
 
-client_info_t active_clients [MAX_CLIENTS];
-int num_active_clients = 0;
-client_info_t best_clients[5];
-pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Best score of each client id seen, kept by the host thread alone: sessions
+// report here when they close, and live ones when scores.log is written
+static client_info_t best_clients[5];
+static volatile sig_atomic_t scores_requested = 0; // SIGUSR1 arrived
 
 static void update_best_clients(int client_id, int points) {
     for (int i = 0; i < 5; i++) {
@@ -88,415 +100,480 @@ static void update_best_clients(int client_id, int points) {
     }
 }
 
-void add_client (int client_id){
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < num_active_clients; i++) {
-        if (active_clients[i].client_id == client_id) {
-            active_clients[i].points = 0;
-            pthread_mutex_unlock(&clients_mutex);
-            return;
-        }
-    }
-
-    if (num_active_clients < MAX_CLIENTS){
-        active_clients[num_active_clients].client_id = client_id;
-        active_clients[num_active_clients].points = 0;
-        num_active_clients++;
-    }
-    update_best_clients(client_id, 0);
-    pthread_mutex_unlock(&clients_mutex);
+// Sessions finished by the workers, released by the host thread
+static session_ctx_t *closed_sessions = NULL;
+static pthread_mutex_t closed_lock = PTHREAD_MUTEX_INITIALIZER;
+static int wake_pipe[2] = {-1, -1}; // wakes the host loop: a session retired, or SIGUSR1
+
+// Sessions accepted and not yet destroyed, newest first, for spectators to
+// find by id. Only the host thread touches it.
+static session_ctx_t *live_sessions = NULL;
+
+// Called by the worker that ran the last step. The host thread owns the
+// request pipe (it is registered in its epoll set), so it does the release.
+static void retire_session(session_ctx_t *ctx) {
+    pthread_mutex_lock(&closed_lock);
+    ctx->next_closed = closed_sessions;
+    closed_sessions = ctx;
+    pthread_mutex_unlock(&closed_lock);
+
+    char wake = 1;
+    write(wake_pipe[1], &wake, 1);
 }
 
-void update_client_points(int client_id, int points){
-    pthread_mutex_lock(&clients_mutex);
-    for(int i = 0; i < num_active_clients; i++){
-        if (active_clients[i].client_id == client_id){
-            active_clients[i].points = points;
-            update_best_clients(client_id, points);
-            break;
-        }
+// Loads the level at ctx->level_idx. Returns 0 on success, -1 on failure.
+static int start_level(session_ctx_t *ctx) {
+    board_t *board = &ctx->board;
+
+    // Parsed once for the whole server and held by the session's catalog,
+    // the session only copies it
+    const char *name = ctx->catalog->names[ctx->level_idx];
+    uint64_t rng = board->rng;
+    if (level_instantiate(ctx->catalog->levels[ctx->level_idx], board, ctx->carry_points) != 0) {
+        fprintf(stderr, "[server] session %d failed to load level %s\n", ctx->session_id, name);
+        return -1;
     }
-    pthread_mutex_unlock(&clients_mutex);
+    board->rng = rng; // the template's state is not the session's
+
+    fprintf(stderr, "[server] session %d level loaded: %s (%dx%d) tempo=%d dots=%d\n",
+            ctx->session_id, board->level_name, board->width, board->height, board->tempo, board->remaining_dots);
+    ctx->level_loaded = 1;
+    frame_reset(&ctx->frames); // versions restart with the new board
+    frame_reset(&ctx->spectators.frames);
+    return 0;
 }
 
-void remove_client (int client_id){
-    pthread_mutex_lock(&clients_mutex);
-    for(int i = 0; i < num_active_clients; i++){
-        if (active_clients[i].client_id == client_id){
-            active_clients[i] = active_clients[--num_active_clients];
-            break;
-        }
+// Sends the player's frame. A client whose pipe stays full is not waited on:
+// its frames are skipped, and after FRAME_MAX_MISSED ticks in a row of taking
+// nothing it is let go like one that closed its pipe.
+// Returns -1 when the session should end.
+static int send_player_frame(session_ctx_t *ctx) {
+    notif_release_hold(ctx->notif_fd, &ctx->notif_hold);
+    if (send_board_update(&ctx->frames, ctx->notif_fd, &ctx->board) == 0) return 0;
+    if (errno == EAGAIN && ctx->frames.missed < FRAME_MAX_MISSED) return 0;
+    if (errno != EAGAIN && errno != EPIPE) return 0; // e.g. no memory, next tick retries
+
+    if (errno == EAGAIN && ctx->frames.missed == FRAME_MAX_MISSED) {
+        fprintf(stderr, "[server] session %d dropped: client took no frame for %d ticks\n", ctx->session_id,
+                FRAME_MAX_MISSED);
     }
-    pthread_mutex_unlock(&clients_mutex);
+    atomic_store(&ctx->disconnected, 1);
+    return -1;
 }
 
-session_ctx_t *buffer[BUFFER_SIZE];
-int buffer_in = 0, buffer_out = 0;
-sem_t empty, full;
-pthread_mutex_t buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-static pthread_mutex_t sessions_lock = PTHREAD_MUTEX_INITIALIZER;
-static int active_sessions = 0;
-static pthread_cond_t sessions_cv = PTHREAD_COND_INITIALIZER;
-static void dec_sessions(void) {
-    pthread_mutex_lock(&sessions_lock);
-    active_sessions--;
-    pthread_cond_signal(&sessions_cv);
-    pthread_mutex_unlock(&sessions_lock);
+// Sends the frame the player just got to the session's spectators
+static void publish_spectators(session_ctx_t *ctx) {
+    ctx->spectators.frames.plays = ctx->frames.plays;
+    spectators_publish(&ctx->spectators, &ctx->board);
 }
 
-static int count_remaining_dots(board_t *board) {
-    int dots = 0;
-    for (int i = 0; i < board->width * board->height; i++) {
-        if (board->board[i].has_dot) {
-            dots++;
-        }
+// Sends the closing frame of the current level and unloads it.
+// Returns 1 when the session should go on to the next level.
+static int finish_level(session_ctx_t *ctx) {
+    board_t *board = &ctx->board;
+
+    int has_next = (ctx->level_idx + 1) < ctx->catalog->count;
+    int next_level = board->victory && has_next;
+    if (next_level) {
+        board->game_over = 0; // signal transition, not final game over
+    } else {
+        board->game_over = 1;
     }
-    return dots;
-}
+    board->version++; // the closing frame always goes out
+    int points_snapshot = board->accumulated_points;
+    send_player_frame(ctx);
+    publish_spectators(ctx);
 
-static int load_levels_list(const char *levels_dir, char level_files[][256], int max_levels) {
-    DIR *d = opendir(levels_dir);
-    if (!d) return 0;
-    struct dirent *de;
-    int count = 0;
-    while ((de = readdir(d)) != NULL) {
-        const char *name = de->d_name;
-        size_t len = strlen(name);
-        if (len > 4 && strcmp(name + len - 4, ".lvl") == 0) {
-            if (count < max_levels) {
-                strncpy(level_files[count], name, 255);
-                level_files[count][255] = '\0';
-                count++;
-            }
-        }
-    }
-    closedir(d);
-    for (int i = 0; i < count; i++) {
-        for (int j = i + 1; j < count; j++) {
-            if (strcmp(level_files[i], level_files[j]) > 0) {
-                char tmp[256];
-                strncpy(tmp, level_files[i], 256);
-                strncpy(level_files[i], level_files[j], 256);
-                strncpy(level_files[j], tmp, 256);
-            }
-        }
+    atomic_store_explicit(&ctx->points, points_snapshot, memory_order_relaxed);
+
+    ctx->carry_points = board->accumulated_points;
+    unload_level(board);
+    ctx->level_loaded = 0;
+
+    if (next_level) {
+        ctx->level_idx++;
     }
-    return count;
+    return next_level;
 }
 
-static int send_board_update(int notif_fd, board_t *board) {
-    int data_size = board->width * board->height;
-    int msg_size = 1 + 4 * 6 + data_size;
-    char *msg = malloc(msg_size);
-    if (!msg) return -1;
-
-    msg[0] = OP_CODE_BOARD;
-    int offset = 1;
-    *(int *)(msg + offset) = board->width; offset += 4;
-    *(int *)(msg + offset) = board->height; offset += 4;
-    *(int *)(msg + offset) = board->tempo; offset += 4;
-    *(int *)(msg + offset) = board->victory; offset += 4;
-    *(int *)(msg + offset) = board->game_over; offset += 4;
-    *(int *)(msg + offset) = board->accumulated_points; offset += 4;
-
-    // Serialize the board as display-ready chars so the client can show dots/portals
-    for (int y = 0; y < board->height; y++) {
-        for (int x = 0; x < board->width; x++) {
-            int idx = y * board->width + x;
-
-            char out = ' ';
-
-            // Ghosts have priority over dots/portal for drawing
-            for (int g = 0; g < board->n_ghosts; g++) {
-                ghost_t *gh = &board->ghosts[g];
-                if (gh->pos_x == x && gh->pos_y == y) {
-                    out = gh->charged ? 'G' : 'M';
-                    goto cell_done;
-                }
-            }
-
-            // Pacman next
-            for (int p = 0; p < board->n_pacmans; p++) {
-                pacman_t *pc = &board->pacmans[p];
-                if (pc->alive && pc->pos_x == x && pc->pos_y == y) {
-                    out = 'C';
-                    goto cell_done;
-                }
-            }
+// Scheduler task: one tick of the session. Takes the pending input, advances
+// every entity (see tick_board for the update order) and publishes the frame.
+// Returns the delay until the next tick, or -1 once the session is closed.
+static int session_step(void *arg) {
+    session_ctx_t *ctx = (session_ctx_t *)arg;
+    board_t *board = &ctx->board;
 
-            // Static tiles
-            if (board->board[idx].content == 'W') {
-                out = '#';
-            } else if (board->board[idx].has_portal) {
-                out = '@';
-            } else if (board->board[idx].has_dot) {
-                out = '.';
-            } else {
-                out = ' ';
-            }
+    if (!ctx->level_loaded && start_level(ctx) != 0) {
+        retire_session(ctx);
+        return -1;
+    }
 
-cell_done:
-            msg[offset + idx] = out;
-        }
+    // Input was already queued by the host thread as it arrived; the last of
+    // the plays taken this tick is the one pacman gets
+    char pending_cmd = '\0';
+    char cmd;
+    for (int i = 0; i < INPUTS_PER_TICK && pending_cmd != 'Q' && input_queue_pop(&ctx->input, &cmd); i++) {
+        pending_cmd = cmd;
     }
+    // Lets a predicting client drop the plays this frame already reflects
+    ctx->frames.plays = (int)(ctx->input.consumed + atomic_load(&ctx->input.dropped));
+    int stop = atomic_load(&ctx->disconnected);
 
-    ssize_t w = write(notif_fd, msg, msg_size);
-    if (w != msg_size) {
-        int saved = errno;
-        perror("write notif board");
-        free(msg);
-        errno = saved;
-        return -1;
+    if (stop) {
+        board->game_over = 1;
+        board->version++;
     }
-    free(msg);
-    return 0;
-}
+    if (pending_cmd == 'Q') {
+        board->game_over = 1;
+        board->version++;
+        stop = 1;
+    } else if (!stop) {
+        tick_board(board, pending_cmd);
+    }
+    int points_snapshot = board->accumulated_points;
+    int level_done = board->victory || board->game_over;
+    if (send_player_frame(ctx) == -1) {
+        level_done = 1; // client closed its pipe or stopped reading it
+    }
+    publish_spectators(ctx);
 
-static void* session_thread(void *arg) {
-    session_ctx_t *ctx = (session_ctx_t *)arg;
-    sigset_t mask;
-    sigemptyset (&mask);
-    sigaddset(&mask, SIGUSR1);
-    pthread_sigmask(SIG_BLOCK, &mask, NULL);      // gameplay threads ignore SIGUSR1
+    if (points_snapshot != atomic_load_explicit(&ctx->points, memory_order_relaxed)) {
+        atomic_store_explicit(&ctx->points, points_snapshot, memory_order_relaxed);
+    }
 
+    if (!level_done) {
+        return board->tempo;
+    }
 
-    int carry_points = 0;
-    char level_files[MAX_LEVELS][256];
-    int num_levels = load_levels_list(ctx->levels_dir, level_files, MAX_LEVELS);
-    if (num_levels == 0) {
-        fprintf(stderr, "[server] session %d found no levels in %s\n", ctx->session_id, ctx->levels_dir);
-        goto cleanup;
+    if (finish_level(ctx)) {
+        return 0; // load next level right away
     }
+    // either final game over or no more levels
+    retire_session(ctx);
+    return -1;
+}
 
-    for (int level_idx = 0; level_idx < num_levels; level_idx++) {
-        board_t board;
-        memset(&board, 0, sizeof(board));
+// epoll tags for the two fds that are not request pipes
+static int reg_tag, wake_tag;
 
-        if (load_level(&board, level_files[level_idx], ctx->levels_dir, carry_points) != 0) {
-            fprintf(stderr, "[server] session %d failed to load level %s\n", ctx->session_id, level_files[level_idx]);
-            goto cleanup;
+static void destroy_session(session_ctx_t *ctx) {
+    for (session_ctx_t **link = &live_sessions; *link; link = &(*link)->next_live) {
+        if (*link == ctx) {
+            *link = ctx->next_live;
+            break;
         }
+    }
+    if (ctx->req_fd != -1) close(ctx->req_fd); // also drops it from the epoll set
+    if (ctx->req_hold != -1) close(ctx->req_hold);
+    if (ctx->notif_fd != -1) close(ctx->notif_fd);
+    if (ctx->notif_hold != -1) close(ctx->notif_hold);
+    update_best_clients(ctx->session_id, atomic_load(&ctx->points));
+    fprintf(stderr, "[server] session %d closed (req=%s notif=%s)\n", ctx->session_id, ctx->req_pipe, ctx->notif_pipe);
+    if (ctx->input.consumed > 0 || atomic_load(&ctx->input.dropped) > 0) {
+        fprintf(stderr, "[server] session %d input: %lu plays, %lu dropped, queue delay avg %.2f ms max %.2f ms\n",
+                ctx->session_id, ctx->input.consumed, atomic_load(&ctx->input.dropped),
+                ctx->input.consumed ? ctx->input.delay_us_sum / 1000.0 / ctx->input.consumed : 0,
+                ctx->input.delay_us_max / 1000.0);
+    }
+    if (ctx->spectators.frames_sent > 0) {
+        fprintf(stderr, "[server] session %d spectators: %lu frames, %lu writes, %lu skipped, %lu dropped\n",
+                ctx->session_id, ctx->spectators.frames_sent, ctx->spectators.writes, ctx->spectators.skipped,
+                ctx->spectators.dropped);
+    }
+    spectators_close(&ctx->spectators);
+    input_queue_free(&ctx->input);
+    frame_free(&ctx->frames);
+    frame_shm_close(&ctx->frames);
+    if (ctx->catalog) level_catalog_release(ctx->catalog);
+    free(ctx);
+}
 
-        fprintf(stderr, "[server] session %d level loaded: %s (%dx%d) tempo=%d dots=%d\n",
-                ctx->session_id, board.level_name, board.width, board.height, board.tempo, count_remaining_dots(&board));
-
-        session_runtime_t rt = {
-            .board = &board,
-            .session_id = ctx->session_id,
-            .stop = 0,
-            .pending_cmd = 0
-        };
-        pthread_mutex_init(&rt.cmd_lock, NULL);
-
-        pthread_t pac_thread;
-        pthread_create(&pac_thread, NULL, pacman_thread, &rt);
-
-        pthread_t ghost_threads[MAX_GHOSTS];
-        int ghost_thread_count = 0;
-        for (int g = 0; g < board.n_ghosts; g++) {
-            ghost_thread_arg_t *garg = malloc(sizeof(ghost_thread_arg_t));
-            if (!garg) continue;
-            garg->runtime = &rt;
-            garg->ghost_index = g;
-            pthread_create(&ghost_threads[ghost_thread_count++], NULL, ghost_thread, garg);
+// Decodes the whole requests at the start of buf, queueing every play.
+// Returns how many bytes were used; the rest is an unfinished request.
+static int decode_requests(session_ctx_t *ctx, const char *buf, int len) {
+    int offset = 0;
+    while (offset < len) {
+        int size = request_size(buf[offset]);
+        if (size == 0) {
+            // Not a request: skip the byte so the stream can resync
+            fprintf(stderr, "[server] session %d sent unknown opcode %d\n", ctx->session_id, buf[offset]);
+            offset++;
+            continue;
         }
+        if (offset + size > len) break;
 
-        while (!rt.stop) {
-            char buf[32];
-            ssize_t n = read(ctx->req_fd, buf, sizeof(buf));
-            if (n == 0) {
-                // Client side closed the request pipe
-                pthread_rwlock_wrlock(&board.state_lock);
-                board.game_over = 1;
-                pthread_rwlock_unlock(&board.state_lock);
-                rt.stop = 1;
-            } else if (n > 0) {
-                // Commands arrive as opcode + payload pairs
-                for (ssize_t i = 0; i + 1 < n; i += 2) {
-                    if (buf[i] == OP_CODE_PLAY) {
-                        char cmd = toupper(buf[i + 1]);
-                        pthread_mutex_lock(&rt.cmd_lock);
-                        rt.pending_cmd = cmd;
-                        pthread_mutex_unlock(&rt.cmd_lock);
-                    } else if (buf[i] == OP_CODE_DISCONNECT) {
-                        pthread_rwlock_wrlock(&board.state_lock);
-                        board.game_over = 1;
-                        pthread_rwlock_unlock(&board.state_lock);
-                        rt.stop = 1;
-                    }
-                }
-            }
+        if (buf[offset] == OP_CODE_PLAY) {
+            input_queue_push(&ctx->input, toupper(buf[offset + 1]));
+        } else if (buf[offset] == OP_CODE_DISCONNECT) {
+            atomic_store(&ctx->disconnected, 1);
+        }
+        offset += size;
+    }
+    return offset;
+}
 
-            pthread_rwlock_rdlock(&board.state_lock);
-            int points_snapshot = board.accumulated_points;
-            int victory = board.victory;
-            int game_over = board.game_over;
-            if (send_board_update(ctx->notif_fd, &board) == -1 && errno == EPIPE) {
-                pthread_rwlock_unlock(&board.state_lock);
-                rt.stop = 1;
-                break; // client closed pipe
-            }
-            pthread_rwlock_unlock(&board.state_lock);
+// Reads whatever the client sent and queues it for the next ticks
+static void handle_requests(int epfd, session_ctx_t *ctx) {
+    // Whatever the last read cut short goes in front of the new bytes
+    char buf[MAX_REQUEST_SIZE + REQUEST_READ_SIZE];
+    int len = ctx->partial_len;
+    memcpy(buf, ctx->partial, len);
+    ssize_t n = read(ctx->req_fd, buf + len, REQUEST_READ_SIZE);
+    if (n == -1 && (errno == EAGAIN || errno == EINTR)) return;
+
+    if (n > 0 && ctx->req_hold != -1) {
+        // The client's writer is open: from now on EOF means it closed it
+        close(ctx->req_hold);
+        ctx->req_hold = -1;
+    }
+    if (n <= 0) {
+        // Client side closed the request pipe
+        atomic_store(&ctx->disconnected, 1);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, ctx->req_fd, NULL);
+        return;
+    }
 
-            update_client_points(ctx->session_id, points_snapshot);
+    len += n;
+    int used = decode_requests(ctx, buf, len);
+    ctx->partial_len = len - used;
+    memcpy(ctx->partial, buf + used, ctx->partial_len);
+}
 
-            if (victory || game_over) {
-                rt.stop = 1;
-                break;
-            }
+// Seed for a session whose client did not choose one; never 0
+static uint64_t fresh_seed(int client_id) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t seed = ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec) ^
+                    ((uint64_t)(unsigned)client_id * 0x9E3779B97F4A7C15ULL);
+    return seed ? seed : 1;
+}
 
-            sleep_ms(board.tempo);
-        }
+// Attaches a spectator to the newest live session with the requested id.
+// The response is written before the session can see the spectator, so it
+// always comes ahead of the frames.
+static void accept_spectator(const char *message) {
+    char notif_pipe[MAX_PIPE_PATH_LENGTH + 1];
+    strncpy(notif_pipe, message + 1, MAX_PIPE_PATH_LENGTH);
+    notif_pipe[MAX_PIPE_PATH_LENGTH] = '\0';
+    int32_t session_id;
+    memcpy(&session_id, message + 1 + MAX_PIPE_PATH_LENGTH, sizeof(session_id));
+
+    session_ctx_t *ctx = live_sessions;
+    while (ctx && ctx->session_id != session_id) ctx = ctx->next_live;
+
+    // Like a player's, opened without waiting for the spectator
+    int notif_hold;
+    int notif_fd = notif_open(notif_pipe, &notif_hold);
+    if (notif_fd == -1) {
+        return;
+    }
+    char response[SPECTATE_RESPONSE_SIZE] = {OP_CODE_SPECTATE, ctx ? 0 : 1};
+    write(notif_fd, response, sizeof(response));
+    if (!ctx || spectators_add(&ctx->spectators, notif_fd, notif_hold) != 0) {
+        fprintf(stderr, "[server] no session %d to spectate (notif=%s)\n", session_id, notif_pipe);
+        close(notif_fd);
+        close(notif_hold);
+        return;
+    }
+    fprintf(stderr, "[server] spectator joined session %d: notif=%s\n", session_id, notif_pipe);
+}
 
-        rt.stop = 1;
-        pthread_join(pac_thread, NULL);
-        for (int g = 0; g < ghost_thread_count; g++) {
-            pthread_join(ghost_threads[g], NULL);
-        }
+// Reads one message from the registration FIFO into message, which holds
+// MAX_REGISTRATION_SIZE bytes. Spectate requests are served right away, they
+// do not take a game slot. Returns 1 if message holds a connect request for
+// accept_session, 0 otherwise.
+static int read_registration(int reg_fd, char *message) {
+    // Opcode first, then just the rest of that message, as long as the
+    // opcode says: messages from several clients may sit back to back.
+    // Each client writes its message at once, so the rest is already there.
+    ssize_t r = read(reg_fd, message, 1);
+    if (r <= 0) {
+        if (r < 0) perror("read reg fifo");
+        else fprintf(stderr, "[server] reg fifo closed by writer?\n");
+        return 0;
+    }
+    int size = registration_size(message[0]);
+    if (size == 0) {
+        // Skip the byte, the next read looks for an opcode after it
+        fprintf(stderr, "[server] ignoring unknown registration opcode %d\n", message[0]);
+        return 0;
+    }
+    ssize_t rest = read(reg_fd, message + 1, size - 1);
+    if (rest > 0) r += rest;
+    fprintf(stderr, "[server] read %zd bytes from reg fifo\n", r);
+    if (r != size) {
+        fprintf(stderr, "[server] ignoring incomplete message (%zd bytes)\n", r);
+        return 0;
+    }
+    if (message[0] == OP_CODE_SPECTATE) {
+        accept_spectator(message);
+        return 0;
+    }
+    return 1;
+}
 
-        pthread_rwlock_rdlock(&board.state_lock);
-        int has_next = (level_idx + 1) < num_levels;
-        if (board.victory && has_next) {
-            board.game_over = 0; // signal transition, not final game over
-        } else {
-            board.game_over = 1;
-        }
-        int points_snapshot = board.accumulated_points;
-        if (send_board_update(ctx->notif_fd, &board) == -1 && errno == EPIPE) {
-            pthread_rwlock_unlock(&board.state_lock);
-        } else {
-            pthread_rwlock_unlock(&board.state_lock);
-        }
+// Accepts one connect request, OP_CODE_CONNECT or OP_CODE_CONNECT_EXT.
+// Returns 1 if a session was started.
+static int accept_session(host_ctx_t *host_ctx, const char *message, int epfd) {
+    int ext = message[0] == OP_CODE_CONNECT_EXT;
 
-        update_client_points(ctx->session_id, points_snapshot);
+    char req_pipe[41];
+    char notif_pipe[41];
+    strncpy(req_pipe, message + 1, 40);
+    req_pipe[40] = '\0';
+    strncpy(notif_pipe, message + 41, 40);
+    notif_pipe[40] = '\0';
 
-        carry_points = board.accumulated_points;
-        pthread_mutex_destroy(&rt.cmd_lock);
-        unload_level(&board);
+    // Parse client ID from pipe name
+    int client_id;
+    if (sscanf(req_pipe, "/tmp/%d_request", &client_id) != 1) {
+        fprintf(stderr, "[server] invalid pipe name %s\n", req_pipe);
+        return 0;
+    }
 
-        if (board.victory && has_next) {
-            continue; // load next level
-        }
-        break; // either final game over or no more levels
+    // None of the opens waits for the client: the host thread serves
+    // everyone else, and a client may never open its ends at all
+    int notif_hold;
+    int notif_fd = notif_open(notif_pipe, &notif_hold);
+    if (notif_fd == -1) {
+        return 0;
+    }
+    int req_fd = open(req_pipe, O_RDONLY | O_NONBLOCK);
+    // Until the client opens its writer, this one keeps the pipe from
+    // reading as EOF (and epoll from reporting a hang-up)
+    int req_hold = req_fd == -1 ? -1 : open(req_pipe, O_WRONLY | O_NONBLOCK);
+    if (req_hold == -1) {
+        if (req_fd != -1) close(req_fd);
+        close(notif_fd);
+        close(notif_hold);
+        return 0;
     }
 
-cleanup:
-    if (ctx->req_fd != -1) close(ctx->req_fd);
-    if (ctx->notif_fd != -1) close(ctx->notif_fd);
-    remove_client(ctx->session_id);
-    dec_sessions();
-    fprintf(stderr, "[server] session %d closed (req=%s notif=%s)\n", ctx->session_id, ctx->req_pipe, ctx->notif_pipe);
-    free(ctx);
-    return NULL;
-}
+    // Shared memory frames must exist before the client hears it got them
+    uint32_t flags = 0, granted = 0;
+    if (ext) memcpy(&flags, message + CONNECT_MESSAGE_SIZE + 8, sizeof(flags));
+    static unsigned next_region; // only the host thread accepts sessions
+    unsigned region = next_region++;
+    frame_state_t frames;
+    memset(&frames, 0, sizeof(frames));
+    if ((flags & CONNECT_FLAG_SHM) && frame_shm_open(&frames, client_id, region) == 0) {
+        granted |= CONNECT_FLAG_SHM;
+    }
 
-void* pacman_thread(void *arg) {
-    session_runtime_t *rt = (session_runtime_t *)arg;
-    board_t *board = rt->board;
-    pacman_t *pacman = &board->pacmans[0];
+    char response[CONNECT_EXT_RESPONSE_SIZE] = {message[0], 0, (char)granted};
+    memcpy(response + 3, &region, sizeof(region));
+    write(notif_fd, response, ext ? CONNECT_EXT_RESPONSE_SIZE : CONNECT_RESPONSE_SIZE);
 
-    while (!rt->stop) {
-        sleep_ms(board->tempo * (1 + pacman->passo));
+    session_ctx_t *ctx = calloc(1, sizeof(session_ctx_t));
+    if (!ctx) {
+        frame_shm_close(&frames);
+        close(req_fd);
+        close(req_hold);
+        close(notif_fd);
+        close(notif_hold);
+        return 0;
+    }
+    ctx->req_fd = req_fd;
+    ctx->req_hold = req_hold;
+    ctx->notif_fd = notif_fd;
+    ctx->notif_hold = notif_hold;
+    strncpy(ctx->req_pipe, req_pipe, sizeof(ctx->req_pipe) - 1);
+    strncpy(ctx->notif_pipe, notif_pipe, sizeof(ctx->notif_pipe) - 1);
+    ctx->session_id = client_id;
+    ctx->frames = frames;
+    ctx->frames.keepalive_ms = host_ctx->keepalive_ms;
+    ctx->spectators.frames.keepalive_ms = host_ctx->keepalive_ms;
+    if (input_queue_init(&ctx->input, host_ctx->input_depth, host_ctx->input_policy) != 0) {
+        destroy_session(ctx);
+        return 0;
+    }
 
-        pthread_rwlock_wrlock(&board->state_lock);
-        if (rt->stop || board->game_over || board->victory || !pacman->alive) {
-            pthread_rwlock_unlock(&board->state_lock);
-            break;
-        }
+    // The client may ask for a seed to replay a game, otherwise pick a fresh one
+    if (ext) memcpy(&ctx->seed, message + CONNECT_MESSAGE_SIZE, sizeof(ctx->seed));
+    if (ctx->seed == 0) ctx->seed = fresh_seed(client_id);
+    seed_board(&ctx->board, ctx->seed);
 
-        command_t *play;
-        command_t c;
-        if (pacman->n_moves == 0) {
-            pthread_mutex_lock(&rt->cmd_lock);
-            char cmd = rt->pending_cmd;
-            rt->pending_cmd = 0;
-            pthread_mutex_unlock(&rt->cmd_lock);
-
-            if (cmd == '\0') {
-                pthread_rwlock_unlock(&board->state_lock);
-                continue;
-            }
-            if (cmd == 'Q') {
-                board->game_over = 1;
-                rt->stop = 1;
-                pthread_rwlock_unlock(&board->state_lock);
-                break;
-            }
+    ctx->catalog = level_catalog_get();
 
-            // Manual control: build a single-move command on the fly
-            c.command = cmd;
-            c.turns = 1;
-            c.turns_left = 1;
-            play = &c;
-        } else {
-            play = &pacman->moves[pacman->current_move % pacman->n_moves];
-        }
+    fprintf(stderr, "[server] new session %d: req=%s notif=%s seed=%llu frames=%s\n", ctx->session_id, req_pipe,
+            notif_pipe, (unsigned long long)ctx->seed, ctx->frames.shm ? ctx->frames.shm_name : "pipe");
 
-        int result = move_pacman(board, 0, play);
-        if (result == REACHED_PORTAL) {
-            board->victory = 1;
-            rt->stop = 1;
-        } else if (result == DEAD_PACMAN) {
-            board->game_over = 1;
-            rt->stop = 1;
-        } else if (!board->victory && !board->game_over && count_remaining_dots(board) == 0) {
-            board->victory = 1;
-            rt->stop = 1;
-        }
-        pthread_rwlock_unlock(&board->state_lock);
+    if (!ctx->catalog || ctx->catalog->count == 0) {
+        fprintf(stderr, "[server] session %d found no levels in %s\n", ctx->session_id, host_ctx->levels_dir);
+        destroy_session(ctx);
+        return 0;
     }
-    return NULL;
-}
 
-void* ghost_thread(void *arg) {
-    ghost_thread_arg_t *ghost_arg = (ghost_thread_arg_t*) arg;
-    session_runtime_t *rt = ghost_arg->runtime;
-    int ghost_ind = ghost_arg->ghost_index;
-    board_t *board = rt->board;
-    free(ghost_arg);
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = ctx};
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, req_fd, &ev) == -1) {
+        perror("epoll_ctl req fifo");
+        destroy_session(ctx);
+        return 0;
+    }
 
-    while (!rt->stop) {
-        ghost_t *ghost = &board->ghosts[ghost_ind];
-        sleep_ms(board->tempo * (1 + ghost->passo));
+    ctx->next_live = live_sessions;
+    live_sessions = ctx;
 
-        pthread_rwlock_wrlock(&board->state_lock);
-        if (rt->stop || board->game_over || board->victory) {
-            pthread_rwlock_unlock(&board->state_lock);
-            break;
-        }
+    // Hand the session over to the worker pool
+    ctx->task.run = session_step;
+    ctx->task.arg = ctx;
+    scheduler_submit(&ctx->task, 0);
+    return 1;
+}
 
-        int res = move_ghost(board, ghost_ind, &ghost->moves[ghost->current_move % ghost->n_moves]);
-        if (res == DEAD_PACMAN) {
-            board->game_over = 1;
-            rt->stop = 1;
-        }
-        pthread_rwlock_unlock(&board->state_lock);
+// Releases the sessions the workers are done with. Returns how many.
+static int reap_sessions(void) {
+    char drain[64];
+    while (read(wake_pipe[0], drain, sizeof(drain)) > 0);
+
+    pthread_mutex_lock(&closed_lock);
+    session_ctx_t *ctx = closed_sessions;
+    closed_sessions = NULL;
+    pthread_mutex_unlock(&closed_lock);
+
+    int count = 0;
+    while (ctx) {
+        session_ctx_t *next = ctx->next_closed;
+        destroy_session(ctx);
+        ctx = next;
+        count++;
     }
-    return NULL;
+    return count;
 }
 
-void* manager_thread_func(void *arg) {
-    (void)arg;
-    while (true) {
-        sem_wait(&full);
-        pthread_mutex_lock(&buffer_mutex);
-        session_ctx_t *ctx = buffer[buffer_out];
-        buffer_out = (buffer_out + 1) % BUFFER_SIZE;
-        pthread_mutex_unlock(&buffer_mutex);
-        sem_post(&empty);
+// Writes the best scores to scores.log, live sessions included
+static void write_scores_log(void) {
+    for (session_ctx_t *ctx = live_sessions; ctx; ctx = ctx->next_live) {
+        update_best_clients(ctx->session_id, atomic_load(&ctx->points));
+    }
 
-        // Increment active sessions
-        pthread_mutex_lock(&sessions_lock);
-        active_sessions++;
-        pthread_mutex_unlock(&sessions_lock);
+    FILE *log_file = fopen("scores.log","w");
+    if (!log_file) return;
 
-        // Handle the session pulled from the queue
-        session_thread(ctx);
+    fprintf(log_file, "=== TOP 5 CLIENTS ===\n");
+    for (int i = 0; i < 5; i++) {
+        if (best_clients[i].client_id != 0) {
+            fprintf(log_file, "Client %d: %d points\n", best_clients[i].client_id, best_clients[i].points);
+        }
     }
-    return NULL;
+    fclose(log_file); // log done
+}
+
+// Only flags the request: the host thread writes the log once epoll_wait
+// returns, when no session is being added or removed
+static void sigusr1_handler (int sig){
+    (void)sig; //unused parameter
+    scores_requested = 1;
+    // The host may be past its check of the flag; the wake pipe makes the
+    // next epoll_wait return however idle the server is
+    int saved_errno = errno;
+    char wake = 1;
+    write(wake_pipe[1], &wake, 1);
+    errno = saved_errno;
 }
 
+// Host thread: a single epoll loop over the registration FIFO, every
+// session's request FIFO and the wake pipe (retiring sessions, SIGUSR1).
 void* host_thread_func(void *arg) {
     host_ctx_t *host_ctx = (host_ctx_t *)arg;
     sigset_t mask;
@@ -511,136 +588,149 @@ void* host_thread_func(void *arg) {
         return NULL;
     }
 
+    int epfd = epoll_create1(0);
+    if (epfd == -1 || pipe(wake_pipe) == -1) {
+        perror("epoll setup");
+        close(reg_fd);
+        return NULL;
+    }
+    fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = &reg_tag};
+    epoll_ctl(epfd, EPOLL_CTL_ADD, reg_fd, &ev);
+    ev.data.ptr = &wake_tag;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, wake_pipe[0], &ev);
+
     fprintf(stderr, "[server] host ready (listening on %s)\n", fifo_registo);
 
+    int active_sessions = 0;
+    int accepting = 1;
+    // Connect requests waiting for a free slot, oldest at held_first
+    char held[MAX_HELD_CONNECTS][MAX_REGISTRATION_SIZE];
+    int held_first = 0, held_count = 0;
     while (true) {
-        char message[1 + MAX_PIPE_PATH_LENGTH + MAX_PIPE_PATH_LENGTH];
-        ssize_t r = read(reg_fd, message, sizeof(message));
-        if (r <= 0) {
-            if (r < 0) perror("read reg fifo");
-            else fprintf(stderr, "[server] reg fifo closed by writer?\n");
-            continue;
+        struct epoll_event events[64];
+        int n = epoll_wait(epfd, events, 64, -1);
+        if (scores_requested) {
+            scores_requested = 0;
+            write_scores_log();
         }
-        fprintf(stderr, "[server] read %zd bytes from reg fifo\n", r);
-        if (r != sizeof(message)) {
-            // Ignore incomplete messages
-            fprintf(stderr, "[server] ignoring incomplete message (%zd bytes)\n", r);
+        if (n == -1) {
+            if (errno != EINTR) perror("epoll_wait");
             continue;
         }
 
-        if (message[0] != OP_CODE_CONNECT) {
-            continue;
+        int woken = 0;
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == &reg_tag && held_count < MAX_HELD_CONNECTS) {
+                int slot = (held_first + held_count) % MAX_HELD_CONNECTS;
+                held_count += read_registration(reg_fd, held[slot]);
+            } else if (tag == &wake_tag) {
+                woken = 1; // reaped last, events in this batch may still point at them
+            } else {
+                handle_requests(epfd, (session_ctx_t *)tag);
+            }
         }
-
-        char req_pipe[41];
-        char notif_pipe[41];
-        strncpy(req_pipe, message + 1, 40);
-        req_pipe[40] = '\0';
-        strncpy(notif_pipe, message + 41, 40);
-        notif_pipe[40] = '\0';
-
-        // Parse client ID from pipe name
-        int client_id;
-        if (sscanf(req_pipe, "/tmp/%d_request", &client_id) != 1) {
-            fprintf(stderr, "[server] invalid pipe name %s\n", req_pipe);
-            continue;
+        if (woken) {
+            active_sessions -= reap_sessions();
         }
-
-        pthread_mutex_lock(&sessions_lock);
-        while (active_sessions >= host_ctx->max_games) {
-            pthread_cond_wait(&sessions_cv, &sessions_lock);
+        while (held_count > 0 && active_sessions < host_ctx->max_games) {
+            active_sessions += accept_session(host_ctx, held[held_first], epfd);
+            held_first = (held_first + 1) % MAX_HELD_CONNECTS;
+            held_count--;
         }
-        pthread_mutex_unlock(&sessions_lock);
 
-        int notif_fd = open(notif_pipe, O_WRONLY);
-        if (notif_fd == -1) {
-            continue;
-        }
-        int req_fd = open(req_pipe, O_RDONLY | O_NONBLOCK);
-        if (req_fd == -1) {
-            close(notif_fd);
-            continue;
+        // While every slot is taken connect requests wait in held, so
+        // spectators still get in; once it is full the FIFO waits as well
+        int should_accept = held_count < MAX_HELD_CONNECTS;
+        if (should_accept != accepting) {
+            ev.events = should_accept ? EPOLLIN : 0;
+            ev.data.ptr = &reg_tag;
+            epoll_ctl(epfd, EPOLL_CTL_MOD, reg_fd, &ev);
+            accepting = should_accept;
         }
-
-        add_client(client_id);
-
-        char response[2] = {OP_CODE_CONNECT, 0};
-        write(notif_fd, response, 2);
-
-        session_ctx_t *ctx = calloc(1, sizeof(session_ctx_t));
-        if (!ctx) {
-            close(req_fd);
-            close(notif_fd);
-            continue;
-        }
-        ctx->req_fd = req_fd;
-        ctx->notif_fd = notif_fd;
-        strncpy(ctx->levels_dir, host_ctx->levels_dir, sizeof(ctx->levels_dir) - 1);
-        strncpy(ctx->req_pipe, req_pipe, sizeof(ctx->req_pipe) - 1);
-        strncpy(ctx->notif_pipe, notif_pipe, sizeof(ctx->notif_pipe) - 1);
-        ctx->session_id = client_id;
-
-        fprintf(stderr, "[server] new session %d: req=%s notif=%s\n", ctx->session_id, req_pipe, notif_pipe);
-
-        // Insert into buffer
-        sem_wait(&empty);
-        pthread_mutex_lock(&buffer_mutex);
-        buffer[buffer_in] = ctx;
-        buffer_in = (buffer_in + 1) % BUFFER_SIZE;
-        pthread_mutex_unlock(&buffer_mutex);
-        sem_post(&full);
     }
 
+    close(epfd);
     close(reg_fd);
     return NULL;
 }
 
-static void sigusr1_handler (int sig){
-    (void)sig; //unused parameter
+int main(int argc, char** argv) {
+    int n_workers = 0; // default: one per core
+    int keepalive_ms = DEFAULT_KEEPALIVE_MS;
+    int input_depth = DEFAULT_INPUT_DEPTH;
+    input_policy_t input_policy = INPUT_DROP_OLDEST;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:k:q:o:")) != -1) {
+        switch (opt) {
+        case 'w':
+            n_workers = atoi(optarg);
+            break;
+        case 'k':
+            keepalive_ms = atoi(optarg);
+            break;
+        case 'q':
+            input_depth = atoi(optarg);
+            if (input_depth <= 0) argc = 0;
+            break;
+        case 'o':
+            if (input_policy_parse(optarg, &input_policy) != 0) argc = 0;
+            break;
+        default:
+            argc = 0; // force usage message
+            break;
+        }
+    }
 
-    FILE *log_file = fopen("scores.log","w");
-    if (!log_file) return;
+    if (argc - optind != 3) {
+        printf("Usage: %s [-w workers] [-k keepalive_ms] [-q input_depth] [-o oldest|newest] <levels_dir|level_pack> <max_games> <fifo_registo>\n", argv[0]);
+        return -1;
+    }
 
-    //lock mutex to safely read active clients
-    pthread_mutex_lock(&clients_mutex);
+    char* levels_dir = argv[optind];
+    int max_games = atoi(argv[optind + 1]);
+    char* fifo_registo = argv[optind + 2];
 
-    client_info_t top5[5] = {0};
-    for (int i = 0; i < num_active_clients; i++) {
-        for (int j = 0; j < 5; j++) {
-            if (active_clients[i].points > top5[j].points) {
-                for (int k = 4; k > j; k--) top5[k] = top5[k-1];
-                top5[j] = active_clients[i];
-                break;
-            }
-        }
-    }
+    fprintf(stderr, "[server] starting, fifo=%s levels_dir=%s max_games=%d\n", fifo_registo, levels_dir, max_games);
 
-        fprintf(log_file, "=== TOP 5 CLIENTS ===\n");
-        for (int i = 0; i < 5; i++) {
-            if (best_clients[i].client_id != 0) {
-                fprintf(log_file, "Client %d: %d points\n", best_clients[i].client_id, best_clients[i].points);
-            }
+    // A regular file is a pack compiled by levelc
+    struct stat st;
+    int is_pack = stat(levels_dir, &st) == 0 && S_ISREG(st.st_mode);
+    if (is_pack) {
+        if (level_cache_use_pack(levels_dir) != 0) {
+            fprintf(stderr, "[server] %s is not a valid level pack\n", levels_dir);
+            return -1;
         }
+        fprintf(stderr, "[server] using level pack %s\n", levels_dir);
+    }
 
-    pthread_mutex_unlock(&clients_mutex);
-    fclose(log_file); // log done
-}
-
-int main(int argc, char** argv) {
-    if (argc != 4) {
-        printf("Usage: %s <levels_dir> <max_games> <fifo_registo>\n", argv[0]);
+    // Sessions walk the sorted catalog instead of listing the directory
+    int n_levels = level_catalog_load(levels_dir);
+    if (n_levels < 0) {
+        fprintf(stderr, "[server] failed to list levels in %s\n", levels_dir);
         return -1;
     }
+    fprintf(stderr, "[server] %d levels in %s\n", n_levels, levels_dir);
 
-    char* levels_dir = argv[1];
-    int max_games = atoi(argv[2]);
-    char* fifo_registo = argv[3];
-
-    fprintf(stderr, "[server] starting, fifo=%s levels_dir=%s max_games=%s\n", fifo_registo, argv[1], argv[2]);
+    if (!is_pack) {
+        if (level_cache_watch(levels_dir) == 0) {
+            fprintf(stderr, "[server] watching %s for level changes\n", levels_dir);
+        } else {
+            perror("[server] inotify");
+        }
+    }
 
     // Avoid crashing on write to closed FIFOs
     signal(SIGPIPE, SIG_IGN);
-    signal(SIGUSR1, sigusr1_handler);
+    // sigaction: under -std=c17 signal() resets the handler once it has run
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigusr1_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
 
     // Block SIGUSR1 in all threads by default; host thread will unblock it
     sigset_t block_all;
@@ -657,10 +747,6 @@ int main(int argc, char** argv) {
 
     fprintf(stderr, "[server] fifo created\n");
 
-    // Init semaphores
-    sem_init(&empty, 0, BUFFER_SIZE);
-    sem_init(&full, 0, 0);
-
     host_ctx_t *ctx = calloc(1, sizeof(host_ctx_t));
     if (!ctx) {
         fprintf(stderr, "[server] failed to alloc host ctx\n");
@@ -669,12 +755,18 @@ int main(int argc, char** argv) {
     strncpy(ctx->fifo_registo, fifo_registo, sizeof(ctx->fifo_registo) - 1);
     strncpy(ctx->levels_dir, levels_dir, sizeof(ctx->levels_dir) - 1);
     ctx->max_games = max_games;
-
-    // Create manager threads
-    pthread_t manager_threads[25];
-    for (int i = 0; i < max_games; i++) {
-        pthread_create(&manager_threads[i], NULL, manager_thread_func, NULL);
+    ctx->keepalive_ms = keepalive_ms;
+    ctx->input_depth = input_depth;
+    ctx->input_policy = input_policy;
+
+    // Create the workers that run every session
+    n_workers = scheduler_start(n_workers);
+    if (n_workers < 0) {
+        fprintf(stderr, "[server] failed to start workers\n");
+        free(ctx);
+        return -1;
     }
+    fprintf(stderr, "[server] %d workers\n", n_workers);
 
     // Create thread to handle connections
     pthread_t host_thread;
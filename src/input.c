@@ -0,0 +1,87 @@
+#include "input.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int input_queue_init(input_queue_t *q, int depth, input_policy_t policy) {
+    unsigned capacity = 1;
+    while (capacity < (unsigned)(depth > 0 ? depth : 1)) capacity <<= 1;
+
+    memset(q, 0, sizeof(*q));
+    q->slots = malloc(capacity * sizeof(*q->slots));
+    if (!q->slots) return -1;
+    for (unsigned i = 0; i < capacity; i++) atomic_init(&q->slots[i], 0);
+    q->mask = capacity - 1;
+    q->policy = policy;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->dropped, 0);
+    return 0;
+}
+
+void input_queue_free(input_queue_t *q) {
+    free(q->slots);
+    q->slots = NULL;
+}
+
+int input_queue_push(input_queue_t *q, char command) {
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+    int result = 0;
+
+    while (tail - head > q->mask) {
+        if (q->policy == INPUT_DROP_NEWEST) {
+            atomic_fetch_add_explicit(&q->dropped, 1, memory_order_relaxed);
+            return -1;
+        }
+        // Races the consumer for the oldest play; on failure head is reloaded
+        if (atomic_compare_exchange_weak_explicit(&q->head, &head, head + 1, memory_order_acq_rel,
+                                                  memory_order_acquire)) {
+            atomic_fetch_add_explicit(&q->dropped, 1, memory_order_relaxed);
+            result = -1;
+            break;
+        }
+    }
+
+    uint64_t entry = now_us() << 8 | (unsigned char)command;
+    atomic_store_explicit(&q->slots[tail & q->mask], entry, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return result;
+}
+
+int input_queue_pop(input_queue_t *q, char *command) {
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    uint64_t entry;
+    do {
+        if (head == atomic_load_explicit(&q->tail, memory_order_acquire)) return 0;
+        entry = atomic_load_explicit(&q->slots[head & q->mask], memory_order_relaxed);
+        // Fails if the producer dropped this play meanwhile, then the entry
+        // read may already be a newer one and is discarded
+    } while (!atomic_compare_exchange_weak_explicit(&q->head, &head, head + 1, memory_order_acq_rel,
+                                                    memory_order_relaxed));
+
+    *command = (char)(entry & 0xff);
+    uint64_t arrived = entry >> 8, now = now_us();
+    uint64_t delay = now > arrived ? now - arrived : 0;
+    q->consumed++;
+    q->delay_us_sum += delay;
+    if (delay > q->delay_us_max) q->delay_us_max = delay;
+    return 1;
+}
+
+int input_policy_parse(const char *name, input_policy_t *policy) {
+    if (strcmp(name, "oldest") == 0) {
+        *policy = INPUT_DROP_OLDEST;
+    } else if (strcmp(name, "newest") == 0) {
+        *policy = INPUT_DROP_NEWEST;
+    } else {
+        return -1;
+    }
+    return 0;
+}
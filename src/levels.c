@@ -0,0 +1,488 @@
+#include "levels.h"
+#include "pack.h"
+#include "debug.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define CACHE_BUCKETS 256
+
+static level_t *cache[CACHE_BUCKETS];
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Set once at startup, before any session runs, and mapped until exit
+static pack_t pack;
+static char pack_path[MAX_FILENAME];
+
+static unsigned int hash_name(const char *dirname, const char *filename) {
+    unsigned int h = 2166136261u; // FNV-1a
+    for (const char *c = dirname; *c; c++) h = (h ^ (unsigned char)*c) * 16777619u;
+    h = (h ^ '/') * 16777619u;
+    for (const char *c = filename; *c; c++) h = (h ^ (unsigned char)*c) * 16777619u;
+    return h % CACHE_BUCKETS;
+}
+
+// Called with cache_lock held
+static level_t *cache_find(unsigned int bucket, const char *dirname, const char *filename) {
+    for (level_t *l = cache[bucket]; l; l = l->next) {
+        if (strcmp(l->filename, filename) == 0 && strcmp(l->dirname, dirname) == 0) {
+            return l;
+        }
+    }
+    return NULL;
+}
+
+static void free_template(level_t *level) {
+    if (level->mapped) {
+        free(level->board.cells);
+        free(level->board.pacmans);
+        free(level->board.ghosts);
+    } else {
+        unload_level(&level->board);
+    }
+    free(level);
+}
+
+static void unpack_moves(command_t *moves, const pack_agent_t *agent) {
+    for (int i = 0; i < agent->n_moves; i++) {
+        moves[i].command = (char)agent->moves[i].command;
+        moves[i].turns = agent->moves[i].turns;
+        moves[i].turns_left = moves[i].command == 'T' ? moves[i].turns : 0;
+    }
+}
+
+// Builds the template from the pack; the bitplanes are used in place
+static int unpack_level(level_t *level) {
+    const pack_level_t *src = pack_find(&pack, level->filename);
+    if (!src) return -1;
+
+    board_t *board = &level->board;
+    board->width = src->width;
+    board->height = src->height;
+    board->tempo = src->tempo;
+    board->remaining_dots = src->remaining_dots;
+    strcpy(board->level_name, src->level_name);
+
+    int words = BITSET_WORDS(src->width * src->height);
+    board->walls = (uint64_t *)pack_bitplanes(src); // read-only, templates are never written
+    board->dots = board->walls + words;
+    board->portals = board->walls + 2 * words;
+    level->mapped = 1;
+
+    board->n_pacmans = src->n_pacmans;
+    board->n_ghosts = src->n_ghosts;
+    board->cells = malloc(src->width * src->height);
+    board->pacmans = calloc(src->n_pacmans, sizeof(pacman_t));
+    board->ghosts = calloc(src->n_ghosts, sizeof(ghost_t));
+    if (!board->cells || (src->n_pacmans && !board->pacmans) || (src->n_ghosts && !board->ghosts)) {
+        return -1;
+    }
+    memset(board->cells, ' ', src->width * src->height);
+
+    // Same placement order as the parser: pacman first, ghosts on top
+    const pack_agent_t *agents = pack_agents(src);
+    for (int i = 0; i < src->n_pacmans; i++) {
+        pacman_t *p = &board->pacmans[i];
+        p->alive = 1;
+        p->pos_x = agents[i].pos_x;
+        p->pos_y = agents[i].pos_y;
+        p->passo = p->waiting = agents[i].passo;
+        p->n_moves = agents[i].n_moves;
+        unpack_moves(p->moves, &agents[i]);
+        board->cells[p->pos_y * board->width + p->pos_x] = 'P';
+    }
+    for (int i = 0; i < src->n_ghosts; i++) {
+        const pack_agent_t *a = &agents[src->n_pacmans + i];
+        ghost_t *g = &board->ghosts[i];
+        g->pos_x = a->pos_x;
+        g->pos_y = a->pos_y;
+        g->passo = g->waiting = a->passo;
+        g->n_moves = a->n_moves;
+        unpack_moves(g->moves, a);
+        board->cells[g->pos_y * board->width + g->pos_x] = 'M';
+    }
+    return 0;
+}
+
+// Called with cache_lock held
+static level_t *cache_unlink(unsigned int bucket, const char *dirname, const char *filename) {
+    for (level_t **link = &cache[bucket]; *link; link = &(*link)->next) {
+        level_t *l = *link;
+        if (strcmp(l->filename, filename) == 0 && strcmp(l->dirname, dirname) == 0) {
+            *link = l->next;
+            return l;
+        }
+    }
+    return NULL;
+}
+
+static level_t *parse_level(const char *dirname, const char *filename) {
+    level_t *level = calloc(1, sizeof(level_t));
+    if (!level) return NULL;
+
+    strncpy(level->dirname, dirname, sizeof(level->dirname) - 1);
+    strncpy(level->filename, filename, sizeof(level->filename) - 1);
+    int res = pack.map && strcmp(dirname, pack_path) == 0
+                  ? unpack_level(level)
+                  : load_level(&level->board, level->filename, level->dirname, 0);
+    if (res != 0) {
+        free_template(level);
+        return NULL;
+    }
+    atomic_init(&level->refs, 1);
+    return level;
+}
+
+level_t *level_cache_get(const char *dirname, const char *filename) {
+    unsigned int bucket = hash_name(dirname, filename);
+
+    pthread_mutex_lock(&cache_lock);
+    level_t *level = cache_find(bucket, dirname, filename);
+    if (level) atomic_fetch_add(&level->refs, 1);
+    pthread_mutex_unlock(&cache_lock);
+    if (level) return level;
+
+    // Parse outside the lock so other lookups are not held up by the disk
+    level_t *parsed = parse_level(dirname, filename);
+    if (!parsed) return NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    level = cache_find(bucket, dirname, filename);
+    if (!level) {
+        // First one in publishes its copy
+        parsed->next = cache[bucket];
+        cache[bucket] = parsed;
+        level = parsed;
+        parsed = NULL;
+        debug("Cached level %s/%s\n", dirname, filename);
+    }
+    atomic_fetch_add(&level->refs, 1);
+    pthread_mutex_unlock(&cache_lock);
+
+    if (parsed) level_release(parsed);
+    return level;
+}
+
+void level_release(level_t *level) {
+    if (atomic_fetch_sub(&level->refs, 1) == 1) {
+        free_template(level);
+    }
+}
+
+// Parses dirname/filename again and swaps it in. Sessions holding the previous
+// template keep playing it; it is freed when the last one lets go.
+static void cache_reload(const char *dirname, const char *filename) {
+    level_t *parsed = parse_level(dirname, filename);
+    if (!parsed) {
+        fprintf(stderr, "[levels] %s/%s failed to load, keeping the previous version\n", dirname, filename);
+        return;
+    }
+
+    unsigned int bucket = hash_name(dirname, filename);
+    pthread_mutex_lock(&cache_lock);
+    level_t *old = cache_unlink(bucket, dirname, filename);
+    parsed->next = cache[bucket];
+    cache[bucket] = parsed;
+    pthread_mutex_unlock(&cache_lock);
+
+    if (old) level_release(old);
+    fprintf(stderr, "[levels] %s %s/%s\n", old ? "reloaded" : "loaded", dirname, filename);
+}
+
+static void cache_drop(const char *dirname, const char *filename) {
+    unsigned int bucket = hash_name(dirname, filename);
+    pthread_mutex_lock(&cache_lock);
+    level_t *old = cache_unlink(bucket, dirname, filename);
+    pthread_mutex_unlock(&cache_lock);
+
+    if (old) {
+        level_release(old);
+        fprintf(stderr, "[levels] dropped %s/%s\n", dirname, filename);
+    }
+}
+
+static int uses_file(const level_t *level, const char *path) {
+    if (strcmp(level->board.pacman_file, path) == 0) return 1;
+    for (int i = 0; i < level->board.n_ghosts; i++) {
+        if (strcmp(level->board.ghosts_files[i], path) == 0) return 1;
+    }
+    return 0;
+}
+
+// A .p or .m file changed: reload the cached levels of dirname that use it
+static void reload_users(const char *dirname, const char *filename) {
+    char path[MAX_FILENAME];
+    snprintf(path, sizeof(path), "%s/%s", dirname, filename);
+
+    char (*names)[MAX_FILENAME] = NULL;
+    int count = 0, cap = 0;
+    pthread_mutex_lock(&cache_lock);
+    for (int b = 0; b < CACHE_BUCKETS; b++) {
+        for (level_t *l = cache[b]; l; l = l->next) {
+            if (strcmp(l->dirname, dirname) != 0 || !uses_file(l, path)) continue;
+            if (count == cap) {
+                cap = cap ? cap * 2 : 8;
+                void *bigger = realloc(names, cap * sizeof(*names));
+                if (!bigger) break;
+                names = bigger;
+            }
+            strcpy(names[count++], l->filename);
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    // Parse outside the lock, sessions keep starting meanwhile
+    for (int i = 0; i < count; i++) cache_reload(dirname, names[i]);
+    free(names);
+}
+
+static int has_suffix(const char *name, const char *suffix) {
+    size_t len = strlen(name), n = strlen(suffix);
+    return len > n && strcmp(name + len - n, suffix) == 0;
+}
+
+// Makes sessions started from now on see the levels as they are now
+static void catalog_refresh(const char *dirname) {
+    if (level_catalog_load(dirname) < 0) {
+        fprintf(stderr, "[levels] failed to rebuild the catalog of %s\n", dirname);
+    }
+}
+
+typedef struct {
+    int fd;
+    char dirname[MAX_FILENAME];
+} watch_t;
+
+static void *watch_thread(void *arg) {
+    watch_t *watch = arg;
+
+    // Events are read in bulk; the buffer must fit at least one full name
+    char buf[16 * (sizeof(struct inotify_event) + MAX_FILENAME)]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (1) {
+        ssize_t n = read(watch->fd, buf, sizeof(buf));
+        if (n <= 0) {
+            perror("[levels] inotify read");
+            break;
+        }
+        for (char *p = buf; p < buf + n; ) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->len == 0 || ev->name[0] == '.') continue;
+
+            // Writes are picked up once the file is closed or renamed into
+            // place, never at creation, when it may still be half written.
+            // Sessions already playing keep the catalog they started with,
+            // and with it every template they will play.
+            int gone = ev->mask & (IN_DELETE | IN_MOVED_FROM);
+            int written = ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (has_suffix(ev->name, ".lvl")) {
+                if (gone) cache_drop(watch->dirname, ev->name);
+                else if (written) cache_reload(watch->dirname, ev->name);
+                catalog_refresh(watch->dirname);
+            } else if (written && (has_suffix(ev->name, ".p") || has_suffix(ev->name, ".m"))) {
+                reload_users(watch->dirname, ev->name);
+                catalog_refresh(watch->dirname);
+            }
+        }
+    }
+
+    close(watch->fd);
+    free(watch);
+    return NULL;
+}
+
+int level_cache_watch(const char *dirname) {
+    watch_t *watch = calloc(1, sizeof(watch_t));
+    if (!watch) return -1;
+    strncpy(watch->dirname, dirname, sizeof(watch->dirname) - 1);
+
+    watch->fd = inotify_init1(IN_CLOEXEC);
+    if (watch->fd == -1 ||
+        inotify_add_watch(watch->fd, dirname, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) == -1) {
+        if (watch->fd != -1) close(watch->fd);
+        free(watch);
+        return -1;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, watch_thread, watch) != 0) {
+        close(watch->fd);
+        free(watch);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+int level_cache_use_pack(const char *path) {
+    if (pack_open(&pack, path) != 0) return -1;
+    strncpy(pack_path, path, sizeof(pack_path) - 1);
+    return 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+int level_list(const char *dirname, char ***names_out) {
+    DIR *d = opendir(dirname);
+    if (!d) return -1;
+    char **names = NULL;
+    int count = 0, cap = 0;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        const char *name = de->d_name;
+        size_t len = strlen(name);
+        if (len <= 4 || len >= MAX_FILENAME || strcmp(name + len - 4, ".lvl") != 0) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            char **bigger = realloc(names, cap * sizeof(char *));
+            if (!bigger) goto fail;
+            names = bigger;
+        }
+        if (!(names[count] = strdup(name))) goto fail;
+        count++;
+    }
+    closedir(d);
+    if (names) qsort(names, count, sizeof(char *), compare_names);
+    *names_out = names;
+    return count;
+
+fail:
+    closedir(d);
+    level_list_free(names, count);
+    return -1;
+}
+
+void level_list_free(char **names, int count) {
+    for (int i = 0; i < count; i++) free(names[i]);
+    free(names);
+}
+
+// Current catalog, swapped whole when the set of levels changes
+static level_catalog_t *catalog = NULL;
+static pthread_mutex_t catalog_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int catalog_add(level_catalog_t *cat, int *cap, const char *name) {
+    if (cat->count == *cap) {
+        *cap = *cap ? *cap * 2 : 64;
+        char **bigger = realloc(cat->names, *cap * sizeof(char *));
+        if (!bigger) return -1;
+        cat->names = bigger;
+    }
+    char *copy = strdup(name);
+    if (!copy) return -1;
+    cat->names[cat->count++] = copy;
+    return 0;
+}
+
+static void catalog_free(level_catalog_t *cat) {
+    for (int i = 0; cat->levels && i < cat->count; i++) level_release(cat->levels[i]);
+    free(cat->levels);
+    level_list_free(cat->names, cat->count);
+    free(cat);
+}
+
+// Takes a reference to the template of every level in cat, parsing the ones
+// not cached yet. Levels that fail to load are left out of the catalog.
+static int catalog_pin(level_catalog_t *cat) {
+    cat->levels = calloc(cat->count ? cat->count : 1, sizeof(level_t *));
+    if (!cat->levels) return -1;
+    int kept = 0;
+    for (int i = 0; i < cat->count; i++) {
+        level_t *level = level_cache_get(cat->dirname, cat->names[i]);
+        if (!level) {
+            fprintf(stderr, "[levels] %s/%s failed to load, left out\n", cat->dirname, cat->names[i]);
+            free(cat->names[i]);
+            continue;
+        }
+        cat->names[kept] = cat->names[i];
+        cat->levels[kept++] = level;
+    }
+    cat->count = kept;
+    return 0;
+}
+
+static level_catalog_t *catalog_build(const char *dirname) {
+    level_catalog_t *cat = calloc(1, sizeof(level_catalog_t));
+    if (!cat) return NULL;
+    strncpy(cat->dirname, dirname, sizeof(cat->dirname) - 1);
+    atomic_init(&cat->refs, 1);
+
+    int cap = 0;
+    if (pack.map && strcmp(dirname, pack_path) == 0) {
+        // Entries are already sorted
+        for (uint32_t i = 0; i < pack.header->n_levels; i++) {
+            if (catalog_add(cat, &cap, pack.entries[i].name) != 0) goto fail;
+        }
+    } else {
+        int count = level_list(dirname, &cat->names);
+        if (count < 0) goto fail;
+        cat->count = count;
+    }
+    if (catalog_pin(cat) != 0) goto fail;
+    return cat;
+
+fail:
+    catalog_free(cat);
+    return NULL;
+}
+
+int level_catalog_load(const char *dirname) {
+    level_catalog_t *cat = catalog_build(dirname);
+    if (!cat) return -1;
+
+    pthread_mutex_lock(&catalog_lock);
+    level_catalog_t *old = catalog;
+    catalog = cat;
+    pthread_mutex_unlock(&catalog_lock);
+
+    if (old) level_catalog_release(old);
+    return cat->count;
+}
+
+level_catalog_t *level_catalog_get(void) {
+    pthread_mutex_lock(&catalog_lock);
+    level_catalog_t *cat = catalog;
+    if (cat) atomic_fetch_add(&cat->refs, 1);
+    pthread_mutex_unlock(&catalog_lock);
+    return cat;
+}
+
+void level_catalog_release(level_catalog_t *cat) {
+    if (atomic_fetch_sub(&cat->refs, 1) == 1) {
+        catalog_free(cat);
+    }
+}
+
+int level_instantiate(const level_t *level, board_t *board, int accumulated_points) {
+    const board_t *src = &level->board;
+    int cells = src->width * src->height;
+    int words = BITSET_WORDS(cells);
+
+    *board = *src;
+    board->cells = NULL;
+    board->walls = NULL;
+    board->pacmans = malloc(src->n_pacmans * sizeof(pacman_t));
+    board->ghosts = malloc(src->n_ghosts * sizeof(ghost_t));
+    if (alloc_board_grid(board) != 0 ||
+        (src->n_pacmans && !board->pacmans) || (src->n_ghosts && !board->ghosts)) {
+        unload_level(board);
+        return -1;
+    }
+
+    memcpy(board->cells, src->cells, cells);
+    memcpy(board->walls, src->walls, 3 * words * sizeof(uint64_t));
+    memcpy(board->pacmans, src->pacmans, src->n_pacmans * sizeof(pacman_t));
+    memcpy(board->ghosts, src->ghosts, src->n_ghosts * sizeof(ghost_t));
+    rebuild_occupancy(board); // pack templates carry no masks
+
+    board->accumulated_points = accumulated_points;
+    if (board->n_pacmans > 0) board->pacmans[0].points = accumulated_points;
+    return 0;
+}
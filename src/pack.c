@@ -0,0 +1,97 @@
+#include "pack.h"
+#include "debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PACK_MAX_CELLS (1 << 26)
+
+static int valid_agent(const pack_agent_t *agent, const pack_level_t *level) {
+    return agent->pos_x >= 0 && agent->pos_x < level->width &&
+           agent->pos_y >= 0 && agent->pos_y < level->height &&
+           agent->n_moves >= 0 && agent->n_moves <= MAX_MOVES;
+}
+
+// Every record must lie inside the map and agree with its own dimensions
+static int valid_entry(const pack_t *pack, const pack_entry_t *entry) {
+    if (entry->offset % 8 != 0 || entry->offset > pack->size ||
+        entry->size > pack->size - entry->offset || entry->size < sizeof(pack_level_t)) {
+        return 0;
+    }
+    if (memchr(entry->name, '\0', sizeof(entry->name)) == NULL) return 0;
+
+    const pack_level_t *level = (const pack_level_t *)((const char *)pack->map + entry->offset);
+    if (level->width <= 0 || level->height <= 0 ||
+        (long long)level->width * level->height > PACK_MAX_CELLS ||
+        level->n_pacmans < 0 || level->n_pacmans > 1 ||
+        level->n_ghosts < 0 || level->n_ghosts > MAX_GHOSTS ||
+        memchr(level->level_name, '\0', sizeof(level->level_name)) == NULL) {
+        return 0;
+    }
+    int n_agents = level->n_pacmans + level->n_ghosts;
+    if (entry->size != pack_level_size(level->width, level->height, n_agents)) return 0;
+
+    const pack_agent_t *agents = pack_agents(level);
+    for (int i = 0; i < n_agents; i++) {
+        if (!valid_agent(&agents[i], level)) return 0;
+    }
+    return 1;
+}
+
+int pack_open(pack_t *pack, const char *path) {
+    memset(pack, 0, sizeof(*pack));
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(pack_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    pack->map = map;
+    pack->size = st.st_size;
+    pack->header = map;
+    pack->entries = (const pack_entry_t *)(pack->header + 1);
+
+    const pack_header_t *header = pack->header;
+    if (memcmp(header->magic, PACK_MAGIC, 4) != 0 || header->version != PACK_VERSION ||
+        header->n_levels > (pack->size - sizeof(pack_header_t)) / sizeof(pack_entry_t)) {
+        debug("%s is not a level pack\n", path);
+        pack_close(pack);
+        return -1;
+    }
+    for (uint32_t i = 0; i < header->n_levels; i++) {
+        if (!valid_entry(pack, &pack->entries[i]) ||
+            (i > 0 && strcmp(pack->entries[i - 1].name, pack->entries[i].name) >= 0)) {
+            debug("Corrupt level pack %s (entry %u)\n", path, i);
+            pack_close(pack);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void pack_close(pack_t *pack) {
+    if (pack->map) munmap(pack->map, pack->size);
+    memset(pack, 0, sizeof(*pack));
+}
+
+static int compare_entry(const void *key, const void *entry) {
+    return strcmp((const char *)key, ((const pack_entry_t *)entry)->name);
+}
+
+const pack_level_t *pack_find(const pack_t *pack, const char *name) {
+    const pack_entry_t *entry = bsearch(name, pack->entries, pack->header->n_levels,
+                                        sizeof(pack_entry_t), compare_entry);
+    if (!entry) return NULL;
+    return (const pack_level_t *)((const char *)pack->map + entry->offset);
+}
@@ -6,21 +6,96 @@
 #include "board.h"
 #include "debug.h"
 #include <fcntl.h>
+#include <sys/stat.h>
+
+// A whole file held in memory, consumed one line at a time
+typedef struct {
+    char *data; // file contents, NUL-terminated
+    char *next; // start of the next unread line
+} text_t;
+
+static int load_text(text_t *text, const char *path) {
+    text->data = NULL;
+    text->next = NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    // One read for the whole file; the buffer grows if the file did
+    size_t cap = st.st_size > 0 ? (size_t)st.st_size + 1 : 4096;
+    size_t size = 0;
+    char *data = malloc(cap);
+    while (data) {
+        if (size + 1 == cap) {
+            char *bigger = realloc(data, cap * 2);
+            if (!bigger) break;
+            data = bigger;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, data + size, cap - size - 1);
+        if (n == 0) {
+            data[size] = '\0';
+            text->data = text->next = data;
+            close(fd);
+            return 0;
+        }
+        if (n == -1) break;
+        size += n;
+    }
+
+    free(data);
+    close(fd);
+    return -1;
+}
+
+// Returns the next line, terminated in place and without its "\\r\\n", or NULL
+// at the end of the file
+static char *next_line(text_t *text, size_t *len) {
+    char *line = text->next;
+    if (!line || *line == '\0') return NULL;
+
+    char *end = strchr(line, '\n');
+    if (end) {
+        *end = '\0';
+        text->next = end + 1;
+    } else {
+        end = line + strlen(line);
+        text->next = end;
+    }
+    if (end > line && end[-1] == '\r') *--end = '\0';
+
+    if (len) *len = end - line;
+    return line;
+}
+
+// Undoes the cut strtok_r made after the first word of a line that turned out
+// not to be a header, so it can be parsed as grid row or move
+static void unsplit(char *line, char *word, size_t len) {
+    char *cut = word + strlen(word);
+    if (cut < line + len) *cut = ' ';
+}
+
+static void free_text(text_t *text) {
+    free(text->data);
+    text->data = text->next = NULL;
+}
 
 int read_level(board_t* board, char* filename, char* dirname) {
 
-    char fullname[MAX_FILENAME];
-    strcpy(fullname, dirname);
-    strcat(fullname, "/");
-    strcat(fullname, filename);
+    char fullname[2 * MAX_FILENAME];
+    snprintf(fullname, sizeof(fullname), "%s/%s", dirname, filename);
 
-    int fd = open(fullname, O_RDONLY);
-    if (fd == -1) {
+    text_t text;
+    if (load_text(&text, fullname) != 0) {
         debug("Error opening file %s\n", fullname);
         return -1;
     }
-    
-    char command[MAX_COMMAND_LENGTH];
 
     // Pacman is optional
     board->pacman_file[0] = '\0';
@@ -29,18 +104,20 @@ int read_level(board_t* board, char* filename, char* dirname) {
     strcpy(board->level_name, filename);
     *strrchr(board->level_name, '.') = '\0';
 
-    int read;
-    while ((read = read_line(fd, command)) > 0) {
+    char *command;
+    size_t len = 0;
+    while ((command = next_line(&text, &len)) != NULL) {
 
         // comment
         if (command[0] == '#' || command[0] == '\0') continue;
 
-        char *word = strtok(command, " \t\n");
+        char *save; // strtok_r, levels are parsed on several threads at once
+        char *word = strtok_r(command, " \t\n", &save);
         if (!word) continue;  // skip empty line
 
         if (strcmp(word, "DIM") == 0) {
-            char *arg1 = strtok(NULL, " \t\n");
-            char *arg2 = strtok(NULL, " \t\n");
+            char *arg1 = strtok_r(NULL, " \t\n", &save);
+            char *arg2 = strtok_r(NULL, " \t\n", &save);
             if (arg1 && arg2) {
                 board->width = atoi(arg1);
                 board->height = atoi(arg2);
@@ -49,7 +126,7 @@ int read_level(board_t* board, char* filename, char* dirname) {
         }
 
         else if (strcmp(word, "TEMPO") == 0) {
-            char *arg = strtok(NULL, " \t\n");
+            char *arg = strtok_r(NULL, " \t\n", &save);
             if (arg) {
                 board->tempo = atoi(arg);
                 debug("TEMPO = %d\n", board->tempo);
@@ -57,7 +134,7 @@ int read_level(board_t* board, char* filename, char* dirname) {
         }
 
         else if (strcmp(word, "PAC") == 0) {
-            char *arg = strtok(NULL, " \t\n");
+            char *arg = strtok_r(NULL, " \t\n", &save);
             if (arg) {
                 snprintf(board->pacman_file, sizeof(board->pacman_file), "%s/%s", dirname, arg);
                 debug("PAC = %s\n", board->pacman_file);
@@ -67,7 +144,7 @@ int read_level(board_t* board, char* filename, char* dirname) {
         else if (strcmp(word, "MON") == 0) {
             char *arg;
             int i = 0;
-            while ((arg = strtok(NULL, " \t\n")) != NULL) {
+            while ((arg = strtok_r(NULL, " \t\n", &save)) != NULL) {
                 snprintf(board->ghosts_files[i], sizeof(board->ghosts_files[0]), "%s/%s", dirname, arg);
                 debug("MON file: %s\n", board->ghosts_files[i]);
                 i+= 1;
@@ -77,24 +154,29 @@ int read_level(board_t* board, char* filename, char* dirname) {
         }
 
         else {
+            unsplit(command, word, len);
             break;
         }
     }
 
     if (!board->width || !board->height) {
         debug("Missing dimensions in level file\n");
-        close(fd);
+        free_text(&text);
         return -1;
     }
     
     // The rest of the file is the grid layout
-    board->board = calloc(board->width * board->height, sizeof(board_pos_t));
+    if (alloc_board_grid(board) != 0) {
+        debug("Failed allocating the board\n");
+        free_text(&text);
+        return -1;
+    }
     board->pacmans = calloc(board->n_pacmans, sizeof(pacman_t));
     board->ghosts = calloc(board->n_ghosts, sizeof(ghost_t));
 
     int row = 0;
     // command here still holds the previous line
-    while (read > 0) {
+    for (; command != NULL; command = next_line(&text, &len)) {
         if (command[0]== '#' || command[0] == '\0') continue;
         if (row >= board->height) break;
 
@@ -102,34 +184,26 @@ int read_level(board_t* board, char* filename, char* dirname) {
 
         for (int col = 0; col < board -> width; col++){
             int idx = row * board->width + col;
-            char content = command[col];
+            char content = (size_t)col < len ? command[col] : ' ';
 
             switch (content) {
                 case 'X': // wall
-                    board->board[idx].content = 'W';
+                    bit_set(board->walls, idx);
                     break;
                 case '@': // portal
-                    board->board[idx].content = ' ';
-                    board->board[idx].has_portal = 1;
+                    bit_set(board->portals, idx);
                     break;
                 default:
-                    board->board[idx].content = ' ';
-                    board->board[idx].has_dot = 1;
+                    bit_set(board->dots, idx);
+                    board->remaining_dots++;
                     break;
             }
         }
 
         row++;
-        read = read_line(fd, command);
-    }
-
-    if (read == -1) {
-      debug("Failed parsing line");
-      close(fd);
-      return read;
     }
 
-    close(fd);
+    free_text(&text);
     return 0;
 }
 
@@ -147,10 +221,10 @@ int read_pacman(board_t* board, int points) {
         for (int i = 0; i < board->height; i++) {
             for (int j = 0; j < board->width; j++) {
                 int idx = i * board->width + j;
-                if (board->board[idx].content == ' ') {
+                if (!bit_test(board->walls, idx) && board->cells[idx] == ' ') {
                     pacman->pos_x = j;
                     pacman->pos_y = i;
-                    board->board[idx].content = 'P';
+                    board->cells[idx] = 'P';
                     goto pacman_inserted;
                 }
             }
@@ -160,19 +234,27 @@ int read_pacman(board_t* board, int points) {
         return 0;
     }
 
-    int fd = open(board->pacman_file, O_RDONLY);
+    pacman->current_move = 0;
+    pacman->n_moves = 0;
 
-    int read;
-    char command[MAX_COMMAND_LENGTH];
-    while ((read = read_line(fd, command)) > 0) {
+    text_t text;
+    if (load_text(&text, board->pacman_file) != 0) {
+        debug("Error opening file %s\n", board->pacman_file);
+        return -1;
+    }
+
+    char *command;
+    size_t len = 0;
+    while ((command = next_line(&text, &len)) != NULL) {
         // comment
         if (command[0] == '#' || command[0] == '\0') continue;
 
-        char *word = strtok(command, " \t\n");
+        char *save;
+        char *word = strtok_r(command, " \t\n", &save);
         if (!word) continue;  // skip empty line
 
         if (strcmp(word, "PASSO") == 0) {
-            char *arg = strtok(NULL, " \t\n");
+            char *arg = strtok_r(NULL, " \t\n", &save);
             if (arg) {
                 pacman->passo = atoi(arg);
                 pacman->waiting = pacman->passo;
@@ -180,27 +262,26 @@ int read_pacman(board_t* board, int points) {
             }
         }
         else if (strcmp(word, "POS") == 0) {
-            char *arg1 = strtok(NULL, " \t\n");
-            char *arg2 = strtok(NULL, " \t\n");
+            char *arg1 = strtok_r(NULL, " \t\n", &save);
+            char *arg2 = strtok_r(NULL, " \t\n", &save);
             if (arg1 && arg2) {
                 pacman->pos_x = atoi(arg1);
                 pacman->pos_y = atoi(arg2);
                 int idx = pacman->pos_y * board->width + pacman->pos_x;
-                board->board[idx].content = 'P';
+                board->cells[idx] = 'P';
                 debug("Pacman Pos = %d x %d\n", pacman->pos_x, pacman->pos_y);
             }
         }
         else {
+            unsplit(command, word, len);
             break;
         }
     }
 
     // end of the file contains the moves
-    pacman->current_move = 0;
-    
     // command here still holds the previous line
     int move = 0;
-    while (read > 0 && move < MAX_MOVES) {
+    for (; command != NULL && move < MAX_MOVES; command = next_line(&text, &len)) {
         if (command[0]== '#' || command[0] == '\0') continue;
         if (command[0] == 'A' ||
             command[0] == 'D' ||
@@ -221,38 +302,38 @@ int read_pacman(board_t* board, int points) {
                 move += 1;
             }
         }
-
-        read = read_line(fd, command);
     }
     pacman->n_moves = move;
 
-    if (read == -1) {
-        debug("Failed reading line\n");
-        close(fd);
-        return -1;
-    }
-
-    close(fd);
+    free_text(&text);
     return 0;
 }
 
 
 int read_ghosts(board_t* board) {
     for (int i = 0; i < board->n_ghosts; i++) {
-        int fd = open(board->ghosts_files[i], O_RDONLY);
         ghost_t* ghost = &board->ghosts[i];
+        ghost->current_move = 0;
+        ghost->n_moves = 0;
 
-        int read;
-        char command[MAX_COMMAND_LENGTH];
-        while ((read = read_line(fd, command)) > 0) {
+        text_t text;
+        if (load_text(&text, board->ghosts_files[i]) != 0) {
+            debug("Error opening file %s\n", board->ghosts_files[i]);
+            return -1;
+        }
+
+        char *command;
+        size_t len = 0;
+        while ((command = next_line(&text, &len)) != NULL) {
             // comment
             if (command[0] == '#' || command[0] == '\0') continue;
 
-            char *word = strtok(command, " \t\n");
+            char *save;
+            char *word = strtok_r(command, " \t\n", &save);
             if (!word) continue;  // skip empty line
 
             if (strcmp(word, "PASSO") == 0) {
-                char *arg = strtok(NULL, " \t\n");
+                char *arg = strtok_r(NULL, " \t\n", &save);
                 if (arg) {
                     ghost->passo = atoi(arg);
                     ghost->waiting = ghost->passo;
@@ -260,27 +341,26 @@ int read_ghosts(board_t* board) {
                 }
             }
             else if (strcmp(word, "POS") == 0) {
-                char *arg1 = strtok(NULL, " \t\n");
-                char *arg2 = strtok(NULL, " \t\n");
+                char *arg1 = strtok_r(NULL, " \t\n", &save);
+                char *arg2 = strtok_r(NULL, " \t\n", &save);
                 if (arg1 && arg2) {
                     ghost->pos_x = atoi(arg1);
                     ghost->pos_y = atoi(arg2);
                     int idx = ghost->pos_y * board->width + ghost->pos_x;
-                    board->board[idx].content = 'M';
+                    board->cells[idx] = 'M';
                     debug("Ghost Pos = %d x %d\n", ghost->pos_x, ghost->pos_y);
                 }
             }
             else {
+                unsplit(command, word, len);
                 break;
             }
         }
 
         // end of the file contains the moves
-        ghost->current_move = 0;
-
         // command here still holds the previous line
         int move = 0;
-        while (read > 0 && move < MAX_MOVES) {
+        for (; command != NULL && move < MAX_MOVES; command = next_line(&text, &len)) {
             if (command[0]== '#' || command[0] == '\0') continue;
             if (command[0] == 'A' ||
                 command[0] == 'D' ||
@@ -301,35 +381,11 @@ int read_ghosts(board_t* board) {
                     move += 1;
                 }
             }
-            read = read_line(fd, command);
         }
         ghost->n_moves = move;
 
-        if (read == -1) {
-            debug("Failed reading line\n");
-            close(fd);
-            return -1;
-        }
-        close(fd);
+        free_text(&text);
     }
 
     return 0;
 }
-
-int read_line(int fd, char *buf) {
-    int i = 0;
-    char c;
-    ssize_t n;
-
-    while ((n = read(fd, &c, 1)) == 1) {
-        if (c == '\r') continue;
-        if (c == '\n') break;
-        buf[i++] = c;
-        if (i == MAX_COMMAND_LENGTH - 1) break;
-    }
-
-    buf[i] = '\0';
-    if (n == -1) return -1;
-    if (n == 0 && i == 0) return 0;
-    return i;                         
-}
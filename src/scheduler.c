@@ -0,0 +1,233 @@
+#include "scheduler.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WHEEL_TICK_MS 5   // timer resolution
+#define WHEEL_SLOTS 256   // one revolution covers WHEEL_SLOTS * WHEEL_TICK_MS ms
+#define RUN_QUEUE_INITIAL 16
+
+typedef struct {
+    pthread_mutex_t lock;
+    task_t **items; // ring buffer, oldest task at head
+    int cap;
+    int head;
+    int count;
+    pthread_t thread;
+    int index;
+} worker_t;
+
+static worker_t *workers = NULL;
+static int n_workers = 0;
+
+// Tasks sitting in run queues, used to park idle workers
+static atomic_int queued = 0;
+static pthread_mutex_t idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_cv = PTHREAD_COND_INITIALIZER;
+
+static task_t *wheel[WHEEL_SLOTS];
+static int wheel_count = 0;
+static uint64_t wheel_now = 0; // last tick processed by the timer thread
+static pthread_mutex_t wheel_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wheel_cv = PTHREAD_COND_INITIALIZER;
+static pthread_t timer_thread;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t now_tick(void) {
+    return now_ms() / WHEEL_TICK_MS;
+}
+
+// Run queue helpers, all called with w->lock held
+
+static int queue_push(worker_t *w, task_t *task) {
+    if (w->count == w->cap) {
+        int new_cap = w->cap ? w->cap * 2 : RUN_QUEUE_INITIAL;
+        task_t **items = malloc(new_cap * sizeof(task_t *));
+        if (!items) return -1;
+        for (int i = 0; i < w->count; i++) {
+            items[i] = w->items[(w->head + i) % w->cap];
+        }
+        free(w->items);
+        w->items = items;
+        w->cap = new_cap;
+        w->head = 0;
+    }
+    w->items[(w->head + w->count) % w->cap] = task;
+    w->count++;
+    return 0;
+}
+
+// Owner side: oldest task first, so tasks run in due order
+static task_t *queue_pop_head(worker_t *w) {
+    if (w->count == 0) return NULL;
+    task_t *task = w->items[w->head];
+    w->head = (w->head + 1) % w->cap;
+    w->count--;
+    return task;
+}
+
+// Thief side: take from the other end to stay out of the owner's way
+static task_t *queue_pop_tail(worker_t *w) {
+    if (w->count == 0) return NULL;
+    w->count--;
+    return w->items[(w->head + w->count) % w->cap];
+}
+
+static void enqueue(worker_t *w, task_t *task) {
+    pthread_mutex_lock(&w->lock);
+    int res = queue_push(w, task);
+    pthread_mutex_unlock(&w->lock);
+    if (res != 0) {
+        // No memory to grow the queue. The wheel needs none, so the task
+        // waits there a tick and tries again rather than being lost.
+        fprintf(stderr, "[scheduler] run queue full, retrying task in %d ms\n", WHEEL_TICK_MS);
+        scheduler_submit(task, WHEEL_TICK_MS);
+        return;
+    }
+
+    atomic_fetch_add(&queued, 1);
+    pthread_mutex_lock(&idle_lock);
+    pthread_cond_signal(&idle_cv);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+static task_t *steal(worker_t *self) {
+    for (int i = 1; i < n_workers; i++) {
+        worker_t *victim = &workers[(self->index + i) % n_workers];
+        pthread_mutex_lock(&victim->lock);
+        task_t *task = queue_pop_tail(victim);
+        pthread_mutex_unlock(&victim->lock);
+        if (task) return task;
+    }
+    return NULL;
+}
+
+static void* worker_thread(void *arg) {
+    worker_t *self = (worker_t *)arg;
+
+    while (1) {
+        pthread_mutex_lock(&self->lock);
+        task_t *task = queue_pop_head(self);
+        pthread_mutex_unlock(&self->lock);
+        if (!task) task = steal(self);
+
+        if (!task) {
+            pthread_mutex_lock(&idle_lock);
+            while (atomic_load(&queued) == 0) {
+                pthread_cond_wait(&idle_cv, &idle_lock);
+            }
+            pthread_mutex_unlock(&idle_lock);
+            continue;
+        }
+        atomic_fetch_sub(&queued, 1);
+
+        int delay = task->run(task->arg);
+        if (delay == 0) {
+            enqueue(self, task);
+        } else if (delay > 0) {
+            scheduler_submit(task, delay);
+        }
+        // delay < 0: task is finished and may already be freed
+    }
+    return NULL;
+}
+
+static void* timer_thread_func(void *arg) {
+    (void)arg;
+    int next_worker = 0;
+
+    pthread_mutex_lock(&wheel_lock);
+    wheel_now = now_tick();
+    while (1) {
+        while (wheel_count == 0) {
+            pthread_cond_wait(&wheel_cv, &wheel_lock);
+        }
+
+        uint64_t target = now_tick();
+        if (target <= wheel_now) {
+            pthread_mutex_unlock(&wheel_lock);
+            struct timespec ts = {0, WHEEL_TICK_MS * 1000000L};
+            nanosleep(&ts, NULL);
+            pthread_mutex_lock(&wheel_lock);
+            continue;
+        }
+
+        // Collect every task that became due since the last pass. After an
+        // idle period the gap can exceed a revolution; each slot is then
+        // visited once.
+        task_t *due = NULL;
+        uint64_t steps = target - wheel_now;
+        if (steps > WHEEL_SLOTS) steps = WHEEL_SLOTS;
+        for (uint64_t t = target - steps + 1; t <= target; t++) {
+            task_t **link = &wheel[t % WHEEL_SLOTS];
+            while (*link) {
+                task_t *task = *link;
+                if (task->due_tick <= target) {
+                    *link = task->next;
+                    task->next = due;
+                    due = task;
+                    wheel_count--;
+                } else {
+                    link = &task->next; // more than one revolution away
+                }
+            }
+        }
+        wheel_now = target;
+        pthread_mutex_unlock(&wheel_lock);
+
+        while (due) {
+            task_t *task = due;
+            due = task->next;
+            task->next = NULL;
+            enqueue(&workers[next_worker], task);
+            next_worker = (next_worker + 1) % n_workers;
+        }
+
+        pthread_mutex_lock(&wheel_lock);
+    }
+    return NULL;
+}
+
+void scheduler_submit(task_t *task, int delay_ms) {
+    if (delay_ms < 0) delay_ms = 0;
+    uint64_t due = (now_ms() + delay_ms) / WHEEL_TICK_MS;
+
+    pthread_mutex_lock(&wheel_lock);
+    if (due <= wheel_now) due = wheel_now + 1;
+    task->due_tick = due;
+    task->next = wheel[due % WHEEL_SLOTS];
+    wheel[due % WHEEL_SLOTS] = task;
+    wheel_count++;
+    pthread_cond_signal(&wheel_cv);
+    pthread_mutex_unlock(&wheel_lock);
+}
+
+int scheduler_start(int count) {
+    if (count <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        count = cores > 0 ? (int)cores : 1;
+    }
+
+    workers = calloc(count, sizeof(worker_t));
+    if (!workers) return -1;
+    n_workers = count;
+
+    for (int i = 0; i < n_workers; i++) {
+        pthread_mutex_init(&workers[i].lock, NULL);
+        workers[i].index = i;
+    }
+    for (int i = 0; i < n_workers; i++) {
+        pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]);
+    }
+    pthread_create(&timer_thread, NULL, timer_thread_func, NULL);
+
+    return n_workers;
+}
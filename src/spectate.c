@@ -0,0 +1,107 @@
+#define _GNU_SOURCE // F_GETPIPE_SZ
+#include "spectate.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+
+#define SPECTATOR_PIPE_CAPACITY 65536 // Linux default, for a pipe whose size cannot be asked
+
+// Size of the pipe behind fd
+static int pipe_capacity(int fd) {
+#ifdef F_GETPIPE_SZ
+    int size = fcntl(fd, F_GETPIPE_SZ);
+    if (size > 0) return size;
+#endif
+    (void)fd;
+    return SPECTATOR_PIPE_CAPACITY;
+}
+
+// Whether size bytes fit whole in the spectator's pipe. Writes up to PIPE_BUF
+// are all or nothing anyway, bigger ones would be cut short by a full pipe.
+static int fits(const spectator_t *sp, int size) {
+    if (size <= PIPE_BUF) return 1;
+    int queued;
+    if (ioctl(sp->fd, FIONREAD, &queued) == -1) return 1; // let the write tell
+    return size <= sp->capacity - queued;
+}
+
+static void free_spectator(spectator_t *sp) {
+    close(sp->fd);
+    if (sp->hold != -1) close(sp->hold);
+    free(sp);
+}
+
+static void free_list(spectator_t *sp) {
+    while (sp) {
+        spectator_t *next = sp->next;
+        free_spectator(sp);
+        sp = next;
+    }
+}
+
+int spectators_add(spectators_t *s, int notif_fd, int hold) {
+    spectator_t *sp = calloc(1, sizeof(*sp));
+    if (!sp) return -1;
+    fcntl(notif_fd, F_SETFL, fcntl(notif_fd, F_GETFL) | O_NONBLOCK);
+    sp->fd = notif_fd;
+    sp->hold = hold;
+    sp->capacity = pipe_capacity(notif_fd);
+    sp->next = atomic_load(&s->joining);
+    while (!atomic_compare_exchange_weak(&s->joining, &sp->next, sp));
+    return 0;
+}
+
+void spectators_publish(spectators_t *s, board_t *board) {
+    spectator_t *joined = atomic_exchange(&s->joining, NULL);
+    while (joined) {
+        spectator_t *next = joined->next;
+        joined->next = s->list;
+        s->list = joined;
+        s->count++;
+        s->stale = 1; // it has no frame to apply a delta to
+        joined = next;
+    }
+    if (!s->list) return;
+
+    const char *msg;
+    int size = frame_serialize(&s->frames, board, s->stale, &msg);
+    if (size <= 0) return; // nothing new, or no memory and the next tick retries
+    s->frames_sent++;
+    s->stale = 0;
+
+    for (spectator_t **link = &s->list; *link;) {
+        spectator_t *sp = *link;
+        notif_release_hold(sp->fd, &sp->hold);
+        ssize_t w = -1;
+        errno = EAGAIN;
+        if (fits(sp, size)) w = write(sp->fd, msg, size);
+        if (w == size) {
+            sp->missed = 0;
+            s->writes++;
+            link = &sp->next;
+            continue;
+        }
+        if (w == -1 && (errno == EAGAIN || errno == EINTR) && ++sp->missed < SPECTATOR_MAX_MISSED) {
+            s->skipped++;
+            s->stale = 1;
+            link = &sp->next;
+            continue;
+        }
+        // Gone (EPIPE), too slow, or left with part of a frame: drop it
+        *link = sp->next;
+        free_spectator(sp);
+        s->count--;
+        s->dropped++;
+    }
+}
+
+void spectators_close(spectators_t *s) {
+    free_list(atomic_exchange(&s->joining, NULL));
+    free_list(s->list);
+    s->list = NULL;
+    s->count = 0;
+    frame_free(&s->frames);
+}
@@ -0,0 +1,143 @@
+#include "board.h"
+#include "levels.h"
+#include "pack.h"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+Compiles the .lvl files of a levels directory, with the .p and .m files they
+reference, into one binary level pack (see pack.h) for the server to map.
+Usage: levelc <levels_dir> <pack_file>
+*/
+
+static void pack_moves(pack_agent_t *out, const command_t *moves, int n_moves) {
+    out->n_moves = n_moves;
+    for (int i = 0; i < n_moves; i++) {
+        out->moves[i].command = moves[i].command;
+        out->moves[i].turns = moves[i].turns;
+    }
+}
+
+// Serializes a loaded board into a level record
+static char *compile_level(board_t *board, size_t *size) {
+    int n_agents = board->n_pacmans + board->n_ghosts;
+    int words = BITSET_WORDS(board->width * board->height);
+    *size = pack_level_size(board->width, board->height, n_agents);
+    char *record = calloc(1, *size);
+    if (!record) return NULL;
+
+    pack_level_t *level = (pack_level_t *)record;
+    level->width = board->width;
+    level->height = board->height;
+    level->tempo = board->tempo;
+    level->n_pacmans = board->n_pacmans;
+    level->n_ghosts = board->n_ghosts;
+    level->remaining_dots = board->remaining_dots;
+    strncpy(level->level_name, board->level_name, sizeof(level->level_name) - 1);
+
+    uint64_t *planes = (uint64_t *)(level + 1);
+    memcpy(planes, board->walls, words * sizeof(uint64_t));
+    memcpy(planes + words, board->dots, words * sizeof(uint64_t));
+    memcpy(planes + 2 * words, board->portals, words * sizeof(uint64_t));
+
+    pack_agent_t *agents = (pack_agent_t *)(planes + 3 * words);
+    for (int i = 0; i < board->n_pacmans; i++) {
+        pacman_t *p = &board->pacmans[i];
+        agents[i].pos_x = p->pos_x;
+        agents[i].pos_y = p->pos_y;
+        agents[i].passo = p->passo;
+        pack_moves(&agents[i], p->moves, p->n_moves);
+    }
+    for (int i = 0; i < board->n_ghosts; i++) {
+        ghost_t *g = &board->ghosts[i];
+        pack_agent_t *a = &agents[board->n_pacmans + i];
+        a->pos_x = g->pos_x;
+        a->pos_y = g->pos_y;
+        a->passo = g->passo;
+        pack_moves(a, g->moves, g->n_moves);
+    }
+    return record;
+}
+
+static int write_all(FILE *f, const void *data, size_t size) {
+    return fwrite(data, 1, size, f) == size ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        printf("Usage: %s <levels_dir> <pack_file>\n", argv[0]);
+        return 1;
+    }
+    char *dir = argv[1];
+    const char *out = argv[2];
+    open_debug_file("/dev/null"); // the parser echoes every row
+
+    char **names;
+    int n_levels = level_list(dir, &names);
+    if (n_levels < 0) {
+        fprintf(stderr, "levelc: cannot read %s\n", dir);
+        return 1;
+    }
+
+    pack_entry_t *entries = calloc(n_levels ? n_levels : 1, sizeof(pack_entry_t));
+    char **records = calloc(n_levels ? n_levels : 1, sizeof(char *));
+    if (!entries || !records) {
+        fprintf(stderr, "levelc: out of memory\n");
+        return 1;
+    }
+
+    uint64_t offset = sizeof(pack_header_t) + n_levels * sizeof(pack_entry_t);
+    for (int i = 0; i < n_levels; i++) {
+        board_t board;
+        memset(&board, 0, sizeof(board));
+        if (load_level(&board, names[i], dir, 0) != 0) {
+            fprintf(stderr, "levelc: failed to load %s/%s\n", dir, names[i]);
+            return 1;
+        }
+        size_t size;
+        records[i] = compile_level(&board, &size);
+        unload_level(&board);
+        if (!records[i]) {
+            fprintf(stderr, "levelc: out of memory\n");
+            return 1;
+        }
+
+        strcpy(entries[i].name, names[i]);
+        entries[i].offset = offset;
+        entries[i].size = size;
+        offset += size; // records are multiples of 8 bytes, so the next stays aligned
+    }
+
+    pack_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.n_levels = n_levels;
+
+    FILE *f = fopen(out, "wb");
+    if (!f) {
+        perror(out);
+        return 1;
+    }
+    int res = write_all(f, &header, sizeof(header));
+    if (res == 0) res = write_all(f, entries, n_levels * sizeof(pack_entry_t));
+    for (int i = 0; i < n_levels && res == 0; i++) {
+        res = write_all(f, records[i], entries[i].size);
+    }
+    if (fclose(f) != 0) res = -1;
+    if (res != 0) {
+        perror(out);
+        remove(out);
+        return 1;
+    }
+
+    printf("levelc: %d levels from %s into %s (%llu bytes)\n", n_levels, dir, out, (unsigned long long)offset);
+    for (int i = 0; i < n_levels; i++) free(records[i]);
+    free(records);
+    free(entries);
+    level_list_free(names, n_levels);
+    close_debug_file();
+    return 0;
+}
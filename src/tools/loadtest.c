@@ -0,0 +1,299 @@
+#include "api.h"
+#include "protocol.h"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/*
+Headless load test: starts the server, forks N virtual clients that connect,
+play a key script and read frames through the client API for a fixed time
+(reconnecting when their game ends), then reports connect latency, frame
+inter-arrival jitter, frames/sec and the server's CPU use from /proc.
+With -m the clients ask for frames through shared memory.
+Usage: loadtest [-n clients] [-t seconds] [-s keys] [-m] <server_binary> <levels_dir>
+*/
+
+#define CLIENT_ID_BASE 70000
+
+// What each client process sends back to the parent, one write per client
+typedef struct {
+    int sessions; // successful connects
+    int shm_sessions; // of those, the ones granted shared memory frames
+    int failures; // connects that did not go through
+    long frames;
+    double connect_ms_sum, connect_ms_max;
+    long gaps; // frame inter-arrival samples
+    double gap_ms_sum, gap_ms_sq_sum, gap_ms_max;
+} client_stats_t;
+
+typedef struct {
+    const char *keys;
+    atomic_int tempo; // ms between plays, follows the frames
+    atomic_int stop;
+} player_t;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Plays the key script at the board's tempo, like the client's file input
+static void *player_thread(void *arg) {
+    player_t *player = arg;
+    size_t n_keys = strlen(player->keys);
+    for (size_t i = 0; !atomic_load(&player->stop); i++) {
+        sleep_ms(atomic_load(&player->tempo));
+        pacman_play(player->keys[i % n_keys]);
+    }
+    return NULL;
+}
+
+static void run_client(int index, const char *fifo, const char *keys, const connect_options_t *options,
+                       double seconds, int out_fd) {
+    client_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+
+    char req_path[MAX_PIPE_PATH_LENGTH], notif_path[MAX_PIPE_PATH_LENGTH];
+    snprintf(req_path, sizeof(req_path), "/tmp/%d_request", CLIENT_ID_BASE + index);
+    snprintf(notif_path, sizeof(notif_path), "/tmp/%d_notification", CLIENT_ID_BASE + index);
+
+    double end = now_ms() + seconds * 1000;
+    while (now_ms() < end) {
+        double start = now_ms();
+        if (pacman_connect_with(req_path, notif_path, fifo, options) != 0) {
+            stats.failures++;
+            sleep_ms(100);
+            continue;
+        }
+        double latency = now_ms() - start;
+        stats.sessions++;
+        stats.shm_sessions += pacman_shared_frames();
+        stats.connect_ms_sum += latency;
+        if (latency > stats.connect_ms_max) stats.connect_ms_max = latency;
+
+        player_t player = {.keys = keys};
+        atomic_init(&player.tempo, 200);
+        atomic_init(&player.stop, 0);
+        pthread_t thread;
+        pthread_create(&thread, NULL, player_thread, &player);
+
+        double last = 0;
+        while (now_ms() < end) {
+            Board board = receive_board_update();
+            if (!board.data) break;
+
+            double t = now_ms();
+            stats.frames++;
+            if (last > 0) {
+                double gap = t - last;
+                stats.gaps++;
+                stats.gap_ms_sum += gap;
+                stats.gap_ms_sq_sum += gap * gap;
+                if (gap > stats.gap_ms_max) stats.gap_ms_max = gap;
+            }
+            last = t;
+            if (board.tempo > 0) atomic_store(&player.tempo, board.tempo);
+            if (board.game_over) break; // the server closes the session after this frame
+        }
+
+        atomic_store(&player.stop, 1);
+        pthread_join(thread, NULL);
+        pacman_disconnect();
+    }
+
+    write(out_fd, &stats, sizeof(stats));
+}
+
+// utime + stime of pid in seconds, -1 if it cannot be read
+static double process_cpu_seconds(pid_t pid) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+
+    // Fields after the command name, which may contain spaces
+    char *p = strrchr(buf, ')');
+    unsigned long utime, stime;
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+        return -1;
+    }
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static pid_t start_server(const char *server, const char *levels, int max_games, const char *fifo) {
+    char games[16];
+    snprintf(games, sizeof(games), "%d", max_games);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        execl(server, server, levels, games, fifo, (char *)NULL);
+        _exit(127);
+    }
+    if (pid < 0) return -1;
+
+    // The server is ready once it has made the FIFO
+    struct stat st;
+    for (int i = 0; i < 100; i++) {
+        if (stat(fifo, &st) == 0 && S_ISFIFO(st.st_mode)) return pid;
+        if (waitpid(pid, NULL, WNOHANG) == pid) return -1;
+        sleep_ms(50);
+    }
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    int n_clients = 10;
+    double seconds = 10;
+    const char *keys = "DDSSAAWW";
+    connect_options_t options = {0};
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:s:m")) != -1) {
+        switch (opt) {
+        case 'n':
+            n_clients = atoi(optarg);
+            break;
+        case 't':
+            seconds = atof(optarg);
+            break;
+        case 's':
+            keys = optarg;
+            break;
+        case 'm':
+            options.shared_frames = 1;
+            break;
+        default:
+            argc = 0; // force usage message
+            break;
+        }
+    }
+    if (argc - optind != 2 || n_clients <= 0 || seconds <= 0 || keys[0] == '\0') {
+        printf("Usage: %s [-n clients] [-t seconds] [-s keys] [-m] <server_binary> <levels_dir>\n", argv[0]);
+        return 1;
+    }
+    const char *server = argv[optind];
+    const char *levels = argv[optind + 1];
+
+    signal(SIGPIPE, SIG_IGN);
+    char fifo[64];
+    snprintf(fifo, sizeof(fifo), "/tmp/loadtest_%d.fifo", (int)getpid());
+
+    pid_t server_pid = start_server(server, levels, n_clients, fifo);
+    if (server_pid < 0) {
+        fprintf(stderr, "loadtest: failed to start %s\n", server);
+        return 1;
+    }
+
+    int results[2];
+    if (pipe(results) != 0) {
+        perror("pipe");
+        return 1;
+    }
+
+    pid_t *clients = calloc(n_clients, sizeof(pid_t));
+    if (!clients) {
+        fprintf(stderr, "loadtest: out of memory\n");
+        return 1;
+    }
+
+    double cpu_start = process_cpu_seconds(server_pid);
+    double wall_start = now_ms();
+    for (int i = 0; i < n_clients; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(results[0]);
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(null_fd, STDERR_FILENO); // the API logs every step
+            open_debug_file("/dev/null");
+            alarm((unsigned)seconds + 30); // never outlive a stuck server
+            run_client(i, fifo, keys, &options, seconds, results[1]);
+            _exit(0);
+        }
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        clients[i] = pid;
+    }
+    close(results[1]);
+
+    client_stats_t total;
+    memset(&total, 0, sizeof(total));
+    double jitter_sum = 0, jitter_max = 0;
+    int reported = 0, jitter_samples = 0;
+    client_stats_t stats;
+    while (read(results[0], &stats, sizeof(stats)) == sizeof(stats)) {
+        reported++;
+        total.sessions += stats.sessions;
+        total.shm_sessions += stats.shm_sessions;
+        total.failures += stats.failures;
+        total.frames += stats.frames;
+        total.connect_ms_sum += stats.connect_ms_sum;
+        if (stats.connect_ms_max > total.connect_ms_max) total.connect_ms_max = stats.connect_ms_max;
+        total.gaps += stats.gaps;
+        total.gap_ms_sum += stats.gap_ms_sum;
+        if (stats.gap_ms_max > total.gap_ms_max) total.gap_ms_max = stats.gap_ms_max;
+
+        // Jitter is the standard deviation of a client's frame gaps
+        if (stats.gaps > 1) {
+            double mean = stats.gap_ms_sum / stats.gaps;
+            double var = stats.gap_ms_sq_sum / stats.gaps - mean * mean;
+            double jitter = sqrt(var > 0 ? var : 0);
+            jitter_sum += jitter;
+            if (jitter > jitter_max) jitter_max = jitter;
+            jitter_samples++;
+        }
+    }
+    close(results[0]);
+    for (int i = 0; i < n_clients; i++) {
+        if (clients[i] > 0) waitpid(clients[i], NULL, 0);
+    }
+    free(clients);
+
+    double wall = (now_ms() - wall_start) / 1000;
+    double cpu_end = process_cpu_seconds(server_pid);
+    kill(server_pid, SIGTERM);
+    waitpid(server_pid, NULL, 0);
+    unlink(fifo);
+
+    printf("loadtest: %d clients for %.1f s against %s %s\n", n_clients, seconds, server, levels);
+    printf("  clients reporting   %d/%d\n", reported, n_clients);
+    printf("  sessions            %d (%d failed connects)\n", total.sessions, total.failures);
+    printf("  frame transport     %s\n", total.shm_sessions == total.sessions ? (total.sessions ? "shared memory" : "-")
+                                        : total.shm_sessions ? "mixed" : "pipe");
+    if (total.sessions > 0) {
+        printf("  connect latency     avg %.2f ms, max %.2f ms\n",
+               total.connect_ms_sum / total.sessions, total.connect_ms_max);
+    }
+    printf("  frames              %ld, %.1f frames/s\n", total.frames, total.frames / wall);
+    if (total.gaps > 0) {
+        printf("  frame gap           avg %.2f ms, max %.2f ms\n", total.gap_ms_sum / total.gaps, total.gap_ms_max);
+    }
+    if (jitter_samples > 0) {
+        printf("  jitter (gap stddev) avg %.2f ms, worst client %.2f ms\n", jitter_sum / jitter_samples, jitter_max);
+    }
+    if (cpu_start >= 0 && cpu_end >= 0) {
+        printf("  server cpu          %.2f s, %.1f%% of one core\n", cpu_end - cpu_start,
+               100 * (cpu_end - cpu_start) / wall);
+    }
+    return reported == n_clients ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+#include "board.h"
+#include "levels.h"
+#include "parser.h"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+Headless fast-forward run of the game: levels are played with tick_board as
+fast as the CPU allows, on a virtual clock that advances by the level's tempo
+each tick instead of sleeping. Reports ticks/sec and how each level ended.
+Pacman follows the level's own script, the .p script given with -p, or the
+keys of an input log given with -i (one key per tick, like the client's
+commands file; once it runs out pacman gets no input).
+Random moves use the board generator; -s gives the seed, e.g. one a server
+session logged, to replay its random moves.
+Exits with 2 when a level is lost or hits the tick limit.
+Usage: sim [-p script.p] [-i input_log] [-n max_ticks] [-r repeat] [-s seed] <levels_dir> [level_file]
+*/
+
+#define DEFAULT_MAX_TICKS 1000000
+
+typedef struct {
+    const char *script; // .p file overriding the level's pacman
+    char *input; // keys from the input log, NUL-terminated
+    long max_ticks;
+} sim_opts_t;
+
+typedef struct {
+    long ticks;
+    long long virtual_ms;
+    double wall; // seconds spent ticking, loading excluded
+    int victory;
+    int game_over;
+    int points;
+} sim_result_t;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Keys of the input log, skipping the blanks the client skips too
+static char *read_input_log(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    size_t cap = 256, len = 0;
+    char *keys = malloc(cap);
+    int ch;
+    while (keys && (ch = fgetc(f)) != EOF) {
+        if (ch == '\n' || ch == '\r' || ch == '\0' || ch == ' ') continue;
+        if (len + 1 == cap) {
+            char *bigger = realloc(keys, cap *= 2);
+            if (!bigger) {
+                free(keys);
+                keys = NULL;
+                break;
+            }
+            keys = bigger;
+        }
+        keys[len++] = (char)toupper(ch);
+    }
+    fclose(f);
+    if (keys) keys[len] = '\0';
+    return keys;
+}
+
+// Swaps the level's pacman for the one described by script
+static int use_script(board_t *board, const char *script) {
+    pacman_t *pacman = &board->pacmans[0];
+    board->cells[pacman->pos_y * board->width + pacman->pos_x] = ' ';
+    snprintf(board->pacman_file, sizeof(board->pacman_file), "%s", script);
+    if (read_pacman(board, board->accumulated_points) != 0) return -1;
+    board->cells[pacman->pos_y * board->width + pacman->pos_x] = 'P';
+    rebuild_occupancy(board);
+    return 0;
+}
+
+// rng is the generator state the level starts from and is left where it ended,
+// so levels chain the way they do in a session
+static int play_level(const char *dir, char *file, const sim_opts_t *opts, int points, uint64_t *rng,
+                      sim_result_t *result) {
+    board_t board;
+    memset(&board, 0, sizeof(board));
+    if (load_level(&board, file, (char *)dir, points) != 0) return -1;
+    board.rng = *rng;
+    if (opts->script && use_script(&board, opts->script) != 0) {
+        fprintf(stderr, "sim: failed to load %s\n", opts->script);
+        unload_level(&board);
+        return -1;
+    }
+
+    memset(result, 0, sizeof(*result));
+    size_t n_input = opts->input ? strlen(opts->input) : 0;
+    double start = now_s();
+    while (!board.victory && !board.game_over && result->ticks < opts->max_ticks) {
+        char cmd = (size_t)result->ticks < n_input ? opts->input[result->ticks] : '\0';
+        tick_board(&board, cmd);
+        result->ticks++;
+        result->virtual_ms += board.tempo; // what session_step would have slept
+    }
+
+    result->wall = now_s() - start;
+    result->victory = board.victory;
+    result->game_over = board.game_over;
+    result->points = board.accumulated_points;
+    *rng = board.rng;
+    unload_level(&board);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    sim_opts_t opts = {.max_ticks = DEFAULT_MAX_TICKS};
+    int repeat = 1;
+    uint64_t seed = 1;
+    const char *input_log = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:i:n:r:s:")) != -1) {
+        switch (opt) {
+        case 'p': opts.script = optarg; break;
+        case 'i': input_log = optarg; break;
+        case 'n': opts.max_ticks = atol(optarg); break;
+        case 'r': repeat = atoi(optarg); break;
+        case 's': seed = strtoull(optarg, NULL, 10); break;
+        default: argc = 0; break; // force usage message
+        }
+    }
+    if (argc - optind < 1 || argc - optind > 2 || opts.max_ticks <= 0 || repeat <= 0) {
+        printf("Usage: %s [-p script.p] [-i input_log] [-n max_ticks] [-r repeat] [-s seed] <levels_dir> [level_file]\n", argv[0]);
+        return 1;
+    }
+    const char *dir = argv[optind];
+    open_debug_file("/dev/null"); // the parser echoes every row
+
+    if (input_log && !(opts.input = read_input_log(input_log))) {
+        fprintf(stderr, "sim: cannot read %s\n", input_log);
+        return 1;
+    }
+
+    // A session plays the levels in level_list order
+    int n_levels = 1;
+    char **levels = &argv[optind + 1];
+    if (argc - optind == 1) n_levels = level_list(dir, &levels);
+    if (n_levels <= 0) {
+        fprintf(stderr, "sim: no levels in %s\n", dir);
+        return 1;
+    }
+
+    // Levels are played in order with points and the generator carried over,
+    // until one is lost; -s takes the seed a server session logged
+    board_t seeded;
+    seed_board(&seeded, seed);
+    uint64_t rng = seeded.rng;
+    long total_ticks = 0;
+    double total_wall = 0;
+    int status = 0;
+    int points = 0;
+    printf("%-16s %10s %12s %10s %14s %8s %s\n", "level", "ticks", "virtual s", "wall ms", "ticks/s", "points", "outcome");
+    for (int i = 0; i < n_levels; i++) {
+        sim_result_t result;
+        double wall = 0;
+        uint64_t level_rng = rng;
+        for (int r = 0; r < repeat; r++) {
+            level_rng = rng; // every repeat replays the same game
+            if (play_level(dir, levels[i], &opts, points, &level_rng, &result) != 0) {
+                fprintf(stderr, "sim: failed to load %s/%s\n", dir, levels[i]);
+                return 1;
+            }
+            wall += result.wall;
+        }
+        wall /= repeat;
+        total_ticks += result.ticks;
+        total_wall += wall;
+
+        const char *outcome = result.victory ? "victory" : result.game_over ? "game over" : "tick limit";
+        printf("%-16s %10ld %12.1f %10.3f %14.0f %8d %s\n", levels[i], result.ticks,
+               result.virtual_ms / 1000.0, wall * 1000, wall > 0 ? result.ticks / wall : 0, result.points, outcome);
+
+        points = result.points;
+        rng = level_rng;
+        if (!result.victory) {
+            status = 2;
+            break;
+        }
+    }
+    if (total_wall > 0) {
+        printf("total: %ld ticks in %.3f ms, %.0f ticks/s\n", total_ticks, total_wall * 1000, total_ticks / total_wall);
+    }
+
+    if (levels != &argv[optind + 1]) level_list_free(levels, n_levels);
+    free(opts.input);
+    close_debug_file();
+    return status;
+}